@@ -0,0 +1,473 @@
+#include "cache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <system_error>
+#include <unistd.h>
+using namespace std;
+namespace fs = std::filesystem;
+
+
+// FNV-1a with the 128-bit parameters
+class Fnv128 {
+public:
+    void add(const void* data, size_t size) {
+        const unsigned char* bytes = (const unsigned char*)data;
+        for (size_t i = 0; i < size; i++) {
+            state ^= bytes[i];
+            state *= prime;
+        }
+    }
+
+    template <typename T>
+    void add(T value) {
+        add(&value, sizeof(value));
+    }
+
+    CacheKey key() const { return {(unsigned long long)(state >> 64), (unsigned long long)state}; }
+
+private:
+    const unsigned __int128 prime = ((unsigned __int128)1 << 88) + (1 << 8) + 0x3b;
+    unsigned __int128 state = ((unsigned __int128)0x6c62272e07bb0142ULL << 64) | 0x62b821756295c58dULL;
+};
+
+string CacheKey::hex() const {
+    char text[33];
+    snprintf(text, sizeof(text), "%016llx%016llx", high, low);
+    return text;
+}
+
+CacheKey resultCacheKey(Span<ProcessSpec> processes, const PolicyConfig& config) {
+    Fnv128 hash;
+    hash.add(ENGINE_VERSION);
+    hash.add((int)config.policy);
+    hash.add(config.quantum);
+    hash.add(config.cpus.cpus);
+    hash.add(config.cpus.cpus > 1 ? config.cpus.balanceInterval : 0);
+    hash.add(config.cpus.costs.contextSwitch);
+    hash.add(config.cpus.costs.migration);
+    hash.add(config.cpus.costs.cacheCold);
+    hash.add(config.cpus.gang);
+    hash.add(config.cpus.telemetryWindow);
+    hash.add((unsigned long long)config.cpus.devices.size());
+    for (const DeviceConfig& device : config.cpus.devices) {
+        hash.add(device.channels);
+        hash.add((int)device.scheduler);
+        hash.add(device.expire);
+    }
+    if (config.policy == POLICY_ADAPTIVE) {
+        const AdaptiveConfig& adaptive =
+            config.cpus.adaptive.rules.empty() ? defaultAdaptiveConfig() : config.cpus.adaptive;
+        hash.add(adaptive.window);
+        hash.add((unsigned long long)adaptive.rules.size());
+        for (const AdaptiveRule& rule : adaptive.rules) {
+            hash.add((int)rule.policy);
+            hash.add((int)rule.metric);
+            hash.add(rule.op.data(), rule.op.size());
+            hash.add(rule.threshold);
+        }
+    }
+    hash.add((unsigned long long)processes.size());
+    for (const ProcessSpec& p : processes) {
+        hash.add(p.arrival);
+        hash.add((unsigned long long)p.cpuBursts.size());
+        hash.add(p.cpuBursts.data(), p.cpuBursts.size() * sizeof(int));
+        hash.add((unsigned long long)p.ioBursts.size());
+        hash.add(p.ioBursts.data(), p.ioBursts.size() * sizeof(int));
+        hash.add((unsigned long long)p.tokens.size());
+        hash.add(p.tokens.data(), p.tokens.size() * sizeof(int));
+        hash.add(p.period);
+        hash.add(p.deadline);
+        size_t groupLength = p.group ? strlen(p.group) : 0;
+        hash.add((unsigned long long)groupLength);
+        hash.add(p.group, groupLength);
+        hash.add(p.weight);
+        hash.add(p.device);
+        hash.add(p.threads);
+        hash.add((unsigned long long)p.threadRuns.size());
+        hash.add(p.threadRuns.data(), p.threadRuns.size() * sizeof(int));
+        hash.add((unsigned long long)p.runs.size());
+        for (const BurstRun& run : p.runs) {
+            hash.add(run.start);
+            hash.add(run.length);
+            hash.add(run.repeat);
+        }
+    }
+    return hash.key();
+}
+
+// Entry layout: magic, schedule flag, then LEB128 varints (times are
+// non-negative except lateness, which is zigzag encoded; schedule starts are
+// stored as the gap after the previous segment; policy switch statistics are
+// raw doubles; segment threads are stored plus one), then an end marker
+static const char MAGIC[8] = {'S', 'C', 'H', 'E', 'D', 'R', 'C', '7'};
+static const char END_MARKER[4] = {'E', 'N', 'D', '!'};
+
+static void putVarint(string& out, unsigned long long value) {
+    while (value >= 0x80) {
+        out.push_back((char)(value | 0x80));
+        value >>= 7;
+    }
+    out.push_back((char)value);
+}
+
+static unsigned long long zigzag(long long value) {
+    return ((unsigned long long)value << 1) ^ (unsigned long long)(value >> 63);
+}
+
+static long long unzigzag(unsigned long long value) {
+    return (long long)(value >> 1) ^ -(long long)(value & 1);
+}
+
+static void putDouble(string& out, double value) {
+    out.append((const char*)&value, sizeof(value));
+}
+
+static bool getDouble(const string& in, size_t& pos, double& value) {
+    if (pos + sizeof(value) > in.size()) {
+        return false;
+    }
+    memcpy(&value, in.data() + pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+static bool getVarint(const string& in, size_t& pos, unsigned long long& value) {
+    value = 0;
+    for (int shift = 0; shift < 64 && pos < in.size(); shift += 7) {
+        unsigned char byte = in[pos++];
+        value |= (unsigned long long)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ResultCache::ResultCache(const string& directory, unsigned long long maxBytes)
+    : directory(directory), maxBytes(maxBytes) {}
+
+string ResultCache::defaultDirectory() {
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) {
+        return string(xdg) + "/sched-sim";
+    }
+    const char* home = getenv("HOME");
+    return string(home && *home ? home : ".") + "/.cache/sched-sim";
+}
+
+void ResultCache::simulate(Span<ProcessSpec> processes, const PolicyConfig& config, MetricsSink& sink) {
+    bool needSchedule = sink.wantsSchedule();
+    if (config.policy == POLICY_PLUGIN) {
+        // The plugin's code is not part of the key
+        hit = false;
+        reportRun(processes, runEngine(processes, config, needSchedule), sink, config.cpus.devices);
+        return;
+    }
+    string path = directory + "/" + resultCacheKey(processes, config).hex() + ".res";
+
+    MultiCpuResult result;
+    hit = load(path, processes.size(), needSchedule, result);
+    if (hit) {
+        // Refresh the use time that eviction goes by
+        error_code ignored;
+        fs::last_write_time(path, fs::file_time_type::clock::now(), ignored);
+    } else {
+        result = runEngine(processes, config, needSchedule);
+        store(path, result, needSchedule);
+    }
+    reportRun(processes, result, sink, config.cpus.devices);
+}
+
+bool ResultCache::load(const string& path, size_t numProcesses, bool needSchedule, MultiCpuResult& result) {
+    ifstream in(path, ios::binary);
+    if (!in) {
+        return false;
+    }
+    stringstream contents;
+    contents << in.rdbuf();
+    string data = contents.str();
+    if (data.size() < sizeof(MAGIC) + 1 + sizeof(END_MARKER) || memcmp(data.data(), MAGIC, sizeof(MAGIC)) != 0 ||
+        memcmp(data.data() + data.size() - sizeof(END_MARKER), END_MARKER, sizeof(END_MARKER)) != 0) {
+        return false;
+    }
+    bool hasSchedule = data[sizeof(MAGIC)] != 0;
+    if (needSchedule && !hasSchedule) {
+        return false;
+    }
+
+    size_t pos = sizeof(MAGIC) + 1;
+    unsigned long long value, count, cpus;
+    if (!getVarint(data, pos, count) || count != numProcesses) {
+        return false;
+    }
+    result.completion.resize(count);
+    for (SimTime& completion : result.completion) {
+        if (!getVarint(data, pos, value)) {
+            return false;
+        }
+        completion = value;
+    }
+    if (!getVarint(data, pos, value)) {
+        return false;
+    }
+    result.makespan = value;
+    if (!getVarint(data, pos, value)) {
+        return false;
+    }
+    result.migrations = value;
+    if (!getVarint(data, pos, value)) {
+        return false;
+    }
+    result.contextSwitches = value;
+    if (!getVarint(data, pos, value)) {
+        return false;
+    }
+    result.overhead = value;
+    unsigned long long slotTime, unallocated, stalled, rows;
+    if (!getVarint(data, pos, slotTime) || !getVarint(data, pos, unallocated) || !getVarint(data, pos, stalled) ||
+        !getVarint(data, pos, rows)) {
+        return false;
+    }
+    result.slotTime = slotTime;
+    result.unallocated = unallocated;
+    result.stalled = stalled;
+    result.rows = rows;
+    if (!getVarint(data, pos, cpus) || cpus > data.size()) {
+        return false;
+    }
+    result.busy.resize(cpus);
+    for (SimTime& busy : result.busy) {
+        if (!getVarint(data, pos, value)) {
+            return false;
+        }
+        busy = value;
+    }
+    result.lateness.resize(cpus);
+    for (vector<SimTime>& lateness : result.lateness) {
+        if (!getVarint(data, pos, count) || count > data.size()) {
+            return false;
+        }
+        lateness.resize(count);
+        for (SimTime& late : lateness) {
+            if (!getVarint(data, pos, value)) {
+                return false;
+            }
+            late = unzigzag(value);
+        }
+    }
+    if (!getVarint(data, pos, count) || count > data.size()) {
+        return false;
+    }
+    result.switches.resize(count);
+    for (PolicySwitch& change : result.switches) {
+        unsigned long long time, cpu, from, to;
+        if (!getVarint(data, pos, time) || !getVarint(data, pos, cpu) || !getVarint(data, pos, from) ||
+            !getVarint(data, pos, to) || !getDouble(data, pos, change.depth) ||
+            !getDouble(data, pos, change.variation) || !getDouble(data, pos, change.shortShare)) {
+            return false;
+        }
+        change.time = time;
+        change.cpu = cpu;
+        change.from = (Policy)from;
+        change.to = (Policy)to;
+    }
+    unsigned long long devices;
+    if (!getVarint(data, pos, devices) || devices > data.size()) {
+        return false;
+    }
+    result.deviceBusy.resize(devices);
+    result.deviceWaits.resize(devices);
+    for (size_t d = 0; d < devices; d++) {
+        if (!getVarint(data, pos, value) || !getVarint(data, pos, count) || count > data.size()) {
+            return false;
+        }
+        result.deviceBusy[d] = value;
+        result.deviceWaits[d].resize(count);
+        for (SimTime& wait : result.deviceWaits[d]) {
+            if (!getVarint(data, pos, value)) {
+                return false;
+            }
+            wait = value;
+        }
+    }
+    unsigned long long width, windows;
+    if (!getVarint(data, pos, width) || !getVarint(data, pos, windows) || windows > data.size()) {
+        return false;
+    }
+    WindowSeries& series = result.telemetry;
+    series.width = width;
+    series.busy.resize(windows);
+    series.queued.resize(windows);
+    series.blocked.resize(windows);
+    series.completions.resize(windows);
+    series.waiting.resize(windows);
+    for (size_t w = 0; w < windows; w++) {
+        unsigned long long busy, queued, blocked, completions, waiting;
+        if (!getVarint(data, pos, busy) || !getVarint(data, pos, queued) || !getVarint(data, pos, blocked) ||
+            !getVarint(data, pos, completions) || !getVarint(data, pos, waiting)) {
+            return false;
+        }
+        series.busy[w] = busy;
+        series.queued[w] = queued;
+        series.blocked[w] = blocked;
+        series.completions[w] = completions;
+        series.waiting[w] = waiting;
+    }
+
+    if (needSchedule) {
+        result.schedule.resize(cpus);
+        for (vector<Segment>& schedule : result.schedule) {
+            if (!getVarint(data, pos, count) || count > data.size()) {
+                return false;
+            }
+            schedule.resize(count);
+            SimTime previousEnd = 0;
+            for (Segment& segment : schedule) {
+                unsigned long long gap, length, process, burst, thread;
+                if (!getVarint(data, pos, gap) || !getVarint(data, pos, length) ||
+                    !getVarint(data, pos, process) || !getVarint(data, pos, burst) || !getVarint(data, pos, thread)) {
+                    return false;
+                }
+                segment.start = previousEnd + gap;
+                segment.end = segment.start + length;
+                segment.process = process;
+                segment.burst = burst;
+                segment.thread = (int)thread - 1;
+                previousEnd = segment.end;
+            }
+        }
+    }
+    return true;
+}
+
+void ResultCache::store(const string& path, const MultiCpuResult& result, bool withSchedule) {
+    string data(MAGIC, sizeof(MAGIC));
+    data.push_back(withSchedule ? 1 : 0);
+    putVarint(data, result.completion.size());
+    for (SimTime completion : result.completion) {
+        putVarint(data, completion);
+    }
+    putVarint(data, result.makespan);
+    putVarint(data, result.migrations);
+    putVarint(data, result.contextSwitches);
+    putVarint(data, result.overhead);
+    putVarint(data, result.slotTime);
+    putVarint(data, result.unallocated);
+    putVarint(data, result.stalled);
+    putVarint(data, result.rows);
+    putVarint(data, result.busy.size());
+    for (SimTime busy : result.busy) {
+        putVarint(data, busy);
+    }
+    for (const vector<SimTime>& lateness : result.lateness) {
+        putVarint(data, lateness.size());
+        for (SimTime late : lateness) {
+            putVarint(data, zigzag(late));
+        }
+    }
+    putVarint(data, result.switches.size());
+    for (const PolicySwitch& change : result.switches) {
+        putVarint(data, change.time);
+        putVarint(data, change.cpu);
+        putVarint(data, change.from);
+        putVarint(data, change.to);
+        putDouble(data, change.depth);
+        putDouble(data, change.variation);
+        putDouble(data, change.shortShare);
+    }
+    putVarint(data, result.deviceBusy.size());
+    for (size_t d = 0; d < result.deviceBusy.size(); d++) {
+        putVarint(data, result.deviceBusy[d]);
+        putVarint(data, result.deviceWaits[d].size());
+        for (SimTime wait : result.deviceWaits[d]) {
+            putVarint(data, wait);
+        }
+    }
+    const WindowSeries& series = result.telemetry;
+    putVarint(data, series.width);
+    putVarint(data, series.windows());
+    for (size_t w = 0; w < series.windows(); w++) {
+        putVarint(data, series.busy[w]);
+        putVarint(data, series.queued[w]);
+        putVarint(data, series.blocked[w]);
+        putVarint(data, series.completions[w]);
+        putVarint(data, series.waiting[w]);
+    }
+    if (withSchedule) {
+        for (const vector<Segment>& schedule : result.schedule) {
+            putVarint(data, schedule.size());
+            SimTime previousEnd = 0;
+            for (const Segment& segment : schedule) {
+                putVarint(data, segment.start - previousEnd);
+                putVarint(data, segment.end - segment.start);
+                putVarint(data, segment.process);
+                putVarint(data, segment.burst);
+                putVarint(data, segment.thread + 1);
+                previousEnd = segment.end;
+            }
+        }
+    }
+    data.append(END_MARKER, sizeof(END_MARKER));
+    if (data.size() > maxBytes) {
+        return;  // Would evict everything else
+    }
+
+    // A failing cache must never fail the run, so errors just skip the store
+    error_code error;
+    fs::create_directories(directory, error);
+    string temporary = path + ".tmp." + to_string(getpid());
+    {
+        ofstream out(temporary, ios::binary | ios::trunc);
+        if (!out.write(data.data(), data.size()) || !out.flush()) {
+            fs::remove(temporary, error);
+            return;
+        }
+    }
+    fs::rename(temporary, path, error);
+    if (error) {
+        fs::remove(temporary, error);
+        return;
+    }
+    evict();
+}
+
+void ResultCache::evict() {
+    struct Entry {
+        fs::file_time_type used;
+        unsigned long long size;
+        fs::path path;
+    };
+    vector<Entry> entries;
+    unsigned long long total = 0;
+    error_code error;
+    for (fs::directory_iterator it(directory, error), end; !error && it != end; it.increment(error)) {
+        if (it->path().extension() != ".res") {
+            continue;
+        }
+        error_code entryError;
+        Entry entry{it->last_write_time(entryError), it->file_size(entryError), it->path()};
+        if (!entryError) {
+            total += entry.size;
+            entries.push_back(entry);
+        }
+    }
+    if (total <= maxBytes) {
+        return;
+    }
+
+    sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.used < b.used; });
+    for (const Entry& entry : entries) {
+        if (total <= maxBytes) {
+            break;
+        }
+        if (fs::remove(entry.path, error)) {
+            total -= entry.size;
+        }
+    }
+}
@@ -0,0 +1,47 @@
+#ifndef CACHE_H
+#define CACHE_H
+
+#include <string>
+#include "simulator.h"
+#include "workload.h"
+
+// 128-bit FNV-1a digest of everything that determines a run's result
+struct CacheKey {
+    unsigned long long high = 0;
+    unsigned long long low = 0;
+
+    std::string hex() const;
+};
+
+// Covers the workload contents, the policy configuration and ENGINE_VERSION.
+// The host thread count is left out because it never changes the result.
+CacheKey resultCacheKey(Span<ProcessSpec> processes, const PolicyConfig& config);
+
+// On-disk cache of simulation results, one file per key. Entries hold the
+// completion times and summary, plus a compact trace when the sink wanted
+// the schedule. Files are written to a temporary name and renamed into
+// place, so readers never see a partial entry. File times track use, and
+// the least recently used entries are evicted above `maxBytes`.
+class ResultCache {
+public:
+    ResultCache(const std::string& directory, unsigned long long maxBytes);
+
+    // Replay a stored result into the sink, or simulate and store it
+    void simulate(Span<ProcessSpec> processes, const PolicyConfig& config, MetricsSink& sink);
+
+    bool lastRunWasHit() const { return hit; }
+
+    // $XDG_CACHE_HOME/sched-sim, else $HOME/.cache/sched-sim
+    static std::string defaultDirectory();
+
+private:
+    bool load(const std::string& path, size_t numProcesses, bool needSchedule, MultiCpuResult& result);
+    void store(const std::string& path, const MultiCpuResult& result, bool withSchedule);
+    void evict();
+
+    std::string directory;
+    unsigned long long maxBytes;
+    bool hit = false;
+};
+
+#endif // CACHE_H
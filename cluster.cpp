@@ -0,0 +1,326 @@
+#include "cluster.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <stdexcept>
+#include <thread>
+#include "pipeline.h"
+using namespace std;
+
+
+bool parseDispatch(const string& text, ClusterConfig& config) {
+    if (text == "random") {
+        config.dispatch = DISPATCH_RANDOM;
+    } else if (text == "rr") {
+        config.dispatch = DISPATCH_ROUND_ROBIN;
+    } else if (text == "jsq") {
+        config.dispatch = DISPATCH_SHORTEST_QUEUE;
+    } else if (text.rfind("pod", 0) == 0) {
+        config.dispatch = DISPATCH_POWER_OF_D;
+        if (text.size() > 3) {
+            char* end;
+            long choices = strtol(text.c_str() + 4, &end, 10);
+            if (text[3] != ':' || end == text.c_str() + 4 || *end || choices < 1) {
+                return false;
+            }
+            config.choices = choices;
+        }
+    } else {
+        return false;
+    }
+    return true;
+}
+
+string dispatchName(const ClusterConfig& config) {
+    switch (config.dispatch) {
+        case DISPATCH_RANDOM: return "random";
+        case DISPATCH_ROUND_ROBIN: return "round-robin";
+        case DISPATCH_SHORTEST_QUEUE: return "join-shortest-queue";
+        case DISPATCH_POWER_OF_D: return "power-of-" + to_string(config.choices);
+    }
+    return "";
+}
+
+MinTree::MinTree(int size, long long initial) : leaves(1) {
+    while (leaves < size) {
+        leaves *= 2;
+    }
+    value.assign(leaves, NEVER);
+    fill(value.begin(), value.begin() + size, initial);
+    best.resize(2 * leaves);
+    for (int i = 0; i < leaves; i++) {
+        best[leaves + i] = i;
+    }
+    for (int node = leaves - 1; node >= 1; node--) {
+        int a = best[2 * node], b = best[2 * node + 1];
+        best[node] = value[b] < value[a] ? b : a;
+    }
+}
+
+void MinTree::set(int i, long long v) {
+    value[i] = v;
+    for (int node = (leaves + i) / 2; node >= 1; node /= 2) {
+        int a = best[2 * node], b = best[2 * node + 1];
+        best[node] = value[b] < value[a] ? b : a;
+    }
+}
+
+// Turnarounds below 32 get a bucket each; above, every power of two is
+// split into 16 buckets
+static const int EXACT_BUCKETS = 32;
+static const int SUB_BUCKETS = 16;
+
+static int histogramBucket(SimTime value) {
+    if (value < EXACT_BUCKETS) {
+        return max<SimTime>(value, 0);
+    }
+    int exponent = 63 - __builtin_clzll(value);
+    return EXACT_BUCKETS + (exponent - 5) * SUB_BUCKETS + (int)((value >> (exponent - 4)) & (SUB_BUCKETS - 1));
+}
+
+// Lowest value of a bucket
+static SimTime histogramValue(int bucket) {
+    if (bucket < EXACT_BUCKETS) {
+        return bucket;
+    }
+    int exponent = (bucket - EXACT_BUCKETS) / SUB_BUCKETS + 5;
+    SimTime sub = (bucket - EXACT_BUCKETS) % SUB_BUCKETS;
+    return (SUB_BUCKETS + sub) << (exponent - 4);
+}
+
+ClusterSimulator::ClusterSimulator(const PolicyConfig& policy, const ClusterConfig& config)
+    : config(config),
+      adaptive(policy.cpus.adaptive.rules.empty() ? defaultAdaptiveConfig() : policy.cpus.adaptive),
+      rng(config.seed) {
+    if (policy.policy == POLICY_RM) {
+        throw invalid_argument("RM ranks the periods of the whole workload and cannot run in a cluster");
+    }
+    if (policy.policy == POLICY_PLUGIN) {
+        throw invalid_argument("policy plugins do not run in a cluster");
+    }
+    if (policy.quantum < 1 && (policy.policy == POLICY_RR || policy.policy == POLICY_CFS)) {
+        throw invalid_argument("time quantum must be at least 1");
+    }
+    if (policy.cpus.cpus != 1 || !policy.cpus.devices.empty() || policy.cpus.gang) {
+        throw invalid_argument("cluster servers have one CPU each and no devices or gangs");
+    }
+    if (config.servers < 1 || config.choices < 1) {
+        throw invalid_argument("a cluster needs at least one server and one choice");
+    }
+
+    servers.resize(config.servers);
+    for (Cpu& cpu : servers) {
+        cpu.policy = policy.policy;
+        cpu.quantum = max(1, policy.quantum);
+        cpu.costs = policy.cpus.costs;
+        cpu.recordSchedule = false;
+        cpu.tasks = &tasks;
+        cpu.decisions = &log;
+        cpu.ready.fifo = (policy.policy == POLICY_FIFO || policy.policy == POLICY_RR);
+        if (policy.policy == POLICY_ADAPTIVE) {
+            cpu.useAdaptive(&adaptive);
+        }
+    }
+    for (int s = 0; s < config.servers; s++) {
+        servers[s].index = s;
+    }
+    jobs.assign(config.servers, 0);
+    if (config.dispatch == DISPATCH_SHORTEST_QUEUE) {
+        shortest = MinTree(config.servers, 0);
+        nextEvents = MinTree(config.servers, NEVER);
+    }
+    histogram.assign(histogramBucket(NEVER) + 1, 0);
+}
+
+// Process the events of a server before time t and collect what it finished
+void ClusterSimulator::catchUp(int server, SimTime t) {
+    Cpu& cpu = servers[server];
+    cpu.advance(t);
+    reap(server);
+    if (config.dispatch == DISPATCH_SHORTEST_QUEUE) {
+        nextEvents.set(server, cpu.nextEvent());
+    }
+}
+
+void ClusterSimulator::reap(int server) {
+    Cpu& cpu = servers[server];
+    for (const Decision& decision : log) {
+        if (decision.kind != DECISION_EXIT) {
+            continue;
+        }
+        int slot = decision.process;
+        SimTime turnaround = decision.time - specs[slot].arrival;
+        SimTime waiting = turnaround - cpuTime[slot];
+        totalTurnaround += turnaround;
+        totalWaiting += waiting;
+        summary.maxTurnaround = max(summary.maxTurnaround, turnaround);
+        summary.maxWaiting = max(summary.maxWaiting, waiting);
+        summary.makespan = max(summary.makespan, decision.time);
+        histogram[histogramBucket(turnaround)]++;
+        freeSlots.push_back(slot);
+        jobs[server]--;
+    }
+    log.clear();
+    if (config.dispatch == DISPATCH_SHORTEST_QUEUE) {
+        shortest.set(server, jobs[server]);
+    }
+
+    // Keep only counts of what would otherwise grow with the job stream
+    for (SimTime lateness : cpu.lateness) {
+        summary.missedDeadlines += lateness > 0;
+    }
+    cpu.lateness.clear();
+    summary.policySwitches += cpu.switches.size();
+    cpu.switches.clear();
+    if (cpu.nextArrival == cpu.arrivals.size()) {
+        cpu.arrivals.clear();
+        cpu.nextArrival = 0;
+    }
+}
+
+int ClusterSimulator::pick() {
+    int n = config.servers;
+    switch (config.dispatch) {
+        case DISPATCH_RANDOM:
+            return uniform_int_distribution<int>(0, n - 1)(rng);
+        case DISPATCH_ROUND_ROBIN: {
+            int server = nextServer;
+            nextServer = (nextServer + 1) % n;
+            return server;
+        }
+        case DISPATCH_SHORTEST_QUEUE:
+            // Bring every server with an earlier event up to the arrival
+            while (nextEvents.min() < clock) {
+                catchUp(nextEvents.argmin(), clock);
+            }
+            return shortest.argmin();
+        case DISPATCH_POWER_OF_D: {
+            uniform_int_distribution<int> uniform(0, n - 1);
+            int best = -1;
+            for (int k = 0; k < config.choices; k++) {
+                int server = uniform(rng);
+                catchUp(server, clock);
+                if (best < 0 || jobs[server] < jobs[best]) {
+                    best = server;
+                }
+            }
+            return best;
+        }
+    }
+    return 0;
+}
+
+void ClusterSimulator::submit(const ProcessSpec& submitted) {
+    ProcessSpec process = threadSpec(submitted, 0);
+    if (process.arrival < clock) {
+        summary.late++;
+    }
+    clock = max(clock, process.arrival);
+    int server = pick();
+    catchUp(server, clock);
+
+    int slot;
+    if (freeSlots.empty()) {
+        slot = specs.size();
+        const ProcessSpec* before = specs.data();
+        specs.emplace_back();
+        tasks.emplace_back();
+        bursts.emplace_back();
+        runs.emplace_back();
+        cpuTime.push_back(0);
+        if (specs.data() != before) {
+            for (Cpu& cpu : servers) {
+                cpu.processes = specs.data();
+            }
+        }
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    vector<int>& storage = bursts[slot];
+    storage.assign(process.cpuBursts.begin(), process.cpuBursts.end());
+    storage.insert(storage.end(), process.ioBursts.begin(), process.ioBursts.end());
+    storage.insert(storage.end(), process.tokens.begin(), process.tokens.end());
+    runs[slot].assign(process.runs.begin(), process.runs.end());
+
+    ProcessSpec& spec = specs[slot];
+    spec.arrival = clock;
+    spec.cpuBursts = Span<int>(storage.data(), process.cpuBursts.size());
+    spec.ioBursts = Span<int>(storage.data() + process.cpuBursts.size(), process.ioBursts.size());
+    spec.tokens = Span<int>(storage.data() + process.cpuBursts.size() + process.ioBursts.size(), process.tokens.size());
+    spec.runs = runs[slot];
+    spec.period = process.period;
+    spec.deadline = process.deadline;
+
+    tasks[slot] = startTask(spec);
+    cpuTime[slot] = totalCpuTime(spec);
+    Cpu& cpu = servers[server];
+    cpu.arrivals.push_back(slot);
+    summary.jobs++;
+    summary.peakJobs = max(summary.peakJobs, ++jobs[server]);
+    if (config.dispatch == DISPATCH_SHORTEST_QUEUE) {
+        shortest.set(server, jobs[server]);
+        nextEvents.set(server, cpu.nextEvent());
+    }
+}
+
+ClusterSummary ClusterSimulator::finish() {
+    for (int s = 0; s < config.servers; s++) {
+        catchUp(s, NEVER);
+    }
+    if (summary.jobs > 0) {
+        summary.averageTurnaround = totalTurnaround / summary.jobs;
+        summary.averageWaiting = totalWaiting / summary.jobs;
+        long long seen = 0;
+        bool median = false;
+        for (int bucket = 0; bucket < (int)histogram.size(); bucket++) {
+            seen += histogram[bucket];
+            if (!median && seen * 2 >= summary.jobs) {
+                summary.p50Turnaround = histogramValue(bucket);
+                median = true;
+            }
+            if (seen * 100 >= summary.jobs * 99) {
+                summary.p99Turnaround = histogramValue(bucket);
+                break;
+            }
+        }
+    }
+
+    SimTime total = 0;
+    SimTime least = NEVER, most = 0;
+    for (const Cpu& cpu : servers) {
+        total += cpu.busy;
+        least = min(least, cpu.busy);
+        most = max(most, cpu.busy);
+        summary.overhead += cpu.overhead;
+    }
+    if (summary.makespan > 0) {
+        summary.meanUtilisation = (double)total / config.servers / summary.makespan;
+        summary.minUtilisation = (double)least / summary.makespan;
+        summary.maxUtilisation = (double)most / summary.makespan;
+    }
+    return summary;
+}
+
+ClusterSummary runCluster(istream& in, const PolicyConfig& policy, const ClusterConfig& config) {
+    ClusterSimulator cluster(policy, config);
+    SpscRing<Process> parsed(4096);
+    thread parser([&]() {
+        string line;
+        Process p;
+        while (getline(in, line)) {
+            if (parseWorkloadLine(line, p)) {
+                parsed.push(move(p));
+            }
+        }
+        parsed.close();
+    });
+
+    Process p;
+    while (parsed.pop(p)) {
+        cluster.submit(p.spec());
+    }
+    parser.join();
+    return cluster.finish();
+}
@@ -0,0 +1,120 @@
+#ifndef CLUSTER_H
+#define CLUSTER_H
+
+#include <istream>
+#include <random>
+#include <string>
+#include <vector>
+#include "simulator.h"
+
+enum Dispatch {
+    DISPATCH_RANDOM,
+    DISPATCH_ROUND_ROBIN,
+    DISPATCH_SHORTEST_QUEUE,        // Join the shortest queue over every server
+    DISPATCH_POWER_OF_D             // Shortest of d servers sampled at random
+};
+
+struct ClusterConfig {
+    int servers = 1000;
+    Dispatch dispatch = DISPATCH_POWER_OF_D;
+    int choices = 2;                // d of power-of-d
+    unsigned long long seed = 1;
+};
+
+// Parse "random", "rr", "jsq" or "pod[:d]" into `config`
+bool parseDispatch(const std::string& text, ClusterConfig& config);
+std::string dispatchName(const ClusterConfig& config);
+
+struct ClusterSummary {
+    long long jobs = 0;
+    long long late = 0;             // Jobs whose arrival was earlier than the previous one
+    SimTime makespan = 0;
+    double averageTurnaround = 0;
+    double averageWaiting = 0;
+    SimTime maxTurnaround = 0;
+    SimTime maxWaiting = 0;
+    // Percentiles from a log histogram, low by less than 1/16 of the value
+    SimTime p50Turnaround = 0;
+    SimTime p99Turnaround = 0;
+    double meanUtilisation = 0;     // Busy time over makespan, across servers
+    double minUtilisation = 0;
+    double maxUtilisation = 0;
+    int peakJobs = 0;               // Most jobs any server held at once
+    long long missedDeadlines = 0;
+    SimTime overhead = 0;           // Busy time spent on switch costs
+    long long policySwitches = 0;
+};
+
+// Min of one value per index, ties to the lowest index. O(log N) updates,
+// O(1) queries.
+class MinTree {
+public:
+    explicit MinTree(int size = 0, long long value = 0);
+    void set(int i, long long value);
+    long long min() const { return value[best[1]]; }
+    int argmin() const { return best[1]; }
+
+private:
+    int leaves;
+    std::vector<long long> value;   // By index; padding holds NEVER
+    std::vector<int> best;          // Index of the minimum under every node
+};
+
+// Dispatches a stream of processes over single-CPU servers that each run
+// the local policy. Every server is a Cpu over one shared pool of job
+// slots, so memory is a Cpu per server plus the jobs still in the system.
+// Servers never interact, so a server only catches up to the current
+// arrival when dispatch looks at it: random and round-robin touch one
+// server per job and power-of-d touches d. Join-the-shortest-queue must see
+// every server, so it also keeps the servers' next events in a MinTree and
+// advances just those that have one before the arrival. Queue length is
+// the number of unfinished jobs on a server, I/O included.
+class ClusterSimulator {
+public:
+    // Uses the policy, quantum, adaptive rules and switch costs of `policy`.
+    // Throws std::invalid_argument for RM, PLUGIN, a bad quantum, more than
+    // one CPU, devices, gangs, or fewer than one server or choice.
+    ClusterSimulator(const PolicyConfig& policy, const ClusterConfig& config);
+
+    // Dispatch a process; its bursts are copied. Processes must come in
+    // arrival order: an earlier one counts as late and arrives with the
+    // previous one. Groups and devices are not simulated, and a
+    // multi-threaded process runs as its first thread.
+    void submit(const ProcessSpec& process);
+
+    // Run every server to completion
+    ClusterSummary finish();
+
+private:
+    int pick();
+    void catchUp(int server, SimTime t);
+    void reap(int server);
+
+    ClusterConfig config;
+    AdaptiveConfig adaptive;
+    std::vector<Cpu> servers;
+    std::vector<int> jobs;                  // Unfinished jobs of every server
+    MinTree shortest;                       // Jobs per server, for JSQ
+    MinTree nextEvents;                     // Next event per server, for JSQ
+    int nextServer = 0;
+    std::mt19937_64 rng;
+    SimTime clock = 0;                      // Latest arrival
+
+    std::vector<ProcessSpec> specs;
+    std::vector<Task> tasks;
+    std::vector<std::vector<int>> bursts;   // CPU bursts, I/O bursts, then run tokens of every slot
+    std::vector<std::vector<BurstRun>> runs;
+    std::vector<SimTime> cpuTime;
+    std::vector<int> freeSlots;
+    std::vector<Decision> log;              // Decisions of the server being advanced
+
+    std::vector<long long> histogram;       // Turnaround counts by log bucket
+    double totalTurnaround = 0;
+    double totalWaiting = 0;
+    ClusterSummary summary;
+};
+
+// Parse the workload on its own thread and dispatch it over a cluster
+ClusterSummary runCluster(std::istream& in, const PolicyConfig& policy, const ClusterConfig& config);
+
+#endif // CLUSTER_H
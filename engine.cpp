@@ -0,0 +1,1434 @@
+#include "engine.h"
+#include "gang.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <numeric>
+#include <thread>
+#include <unordered_map>
+using namespace std;
+
+
+bool parsePolicy(const string& name, Policy& policy) {
+    if (name == "FIFO") {
+        policy = POLICY_FIFO;
+    } else if (name == "SJF") {
+        policy = POLICY_SJF;
+    } else if (name == "SRTF") {
+        policy = POLICY_SRTF;
+    } else if (name == "RR") {
+        policy = POLICY_RR;
+    } else if (name == "CFS") {
+        policy = POLICY_CFS;
+    } else if (name == "EDF") {
+        policy = POLICY_EDF;
+    } else if (name == "RM") {
+        policy = POLICY_RM;
+    } else if (name == "ADAPTIVE") {
+        policy = POLICY_ADAPTIVE;
+    } else if (name == "PLUGIN") {
+        policy = POLICY_PLUGIN;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+const char* policyName(Policy policy) {
+    switch (policy) {
+    case POLICY_FIFO: return "FIFO";
+    case POLICY_SJF: return "SJF";
+    case POLICY_SRTF: return "SRTF";
+    case POLICY_RR: return "RR";
+    case POLICY_CFS: return "CFS";
+    case POLICY_EDF: return "EDF";
+    case POLICY_RM: return "RM";
+    case POLICY_ADAPTIVE: return "ADAPTIVE";
+    case POLICY_PLUGIN: return "PLUGIN";
+    }
+    return "?";
+}
+
+bool parseAdaptiveRules(const string& text, AdaptiveConfig& config) {
+    vector<AdaptiveRule> rules;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        string item = text.substr(start, comma == string::npos ? string::npos : comma - start);
+        start = comma == string::npos ? text.size() + 1 : comma + 1;
+
+        AdaptiveRule rule;
+        size_t colon = item.find(':');
+        if (!parsePolicy(item.substr(0, colon), rule.policy) || rule.policy == POLICY_CFS ||
+            rule.policy == POLICY_EDF || rule.policy == POLICY_RM || rule.policy == POLICY_ADAPTIVE) {
+            return false;
+        }
+        if (colon != string::npos) {
+            string condition = item.substr(colon + 1);
+            size_t opStart = condition.find_first_of("<>");
+            if (opStart == string::npos) {
+                return false;
+            }
+            string metric = condition.substr(0, opStart);
+            if (metric == "depth") {
+                rule.metric = ADAPT_DEPTH;
+            } else if (metric == "cv") {
+                rule.metric = ADAPT_VARIATION;
+            } else if (metric == "short") {
+                rule.metric = ADAPT_SHORT;
+            } else {
+                return false;
+            }
+            size_t opEnd = condition[opStart + 1] == '=' ? opStart + 2 : opStart + 1;
+            rule.op = condition.substr(opStart, opEnd - opStart);
+            char* end;
+            rule.threshold = strtod(condition.c_str() + opEnd, &end);
+            if (end == condition.c_str() + opEnd || *end) {
+                return false;
+            }
+        }
+        rules.push_back(rule);
+    }
+    config.rules = rules;
+    return true;
+}
+
+const AdaptiveConfig& defaultAdaptiveConfig() {
+    static const AdaptiveConfig config = [] {
+        AdaptiveConfig defaults;
+        parseAdaptiveRules("FIFO:depth<2,SRTF:cv>=1,RR", defaults);
+        return defaults;
+    }();
+    return config;
+}
+
+bool parseDevices(const string& text, vector<DeviceConfig>& devices) {
+    vector<DeviceConfig> parsed;
+    size_t start = 0;
+    while (start <= text.size()) {
+        size_t comma = text.find(',', start);
+        string item = text.substr(start, comma == string::npos ? string::npos : comma - start);
+        start = comma == string::npos ? text.size() + 1 : comma + 1;
+
+        DeviceConfig device;
+        size_t colon = item.find(':');
+        char* end;
+        device.channels = strtol(item.c_str(), &end, 10);
+        if (end == item.c_str() || (*end && *end != ':') || device.channels < 1) {
+            return false;
+        }
+        if (colon != string::npos) {
+            size_t second = item.find(':', colon + 1);
+            string name = item.substr(colon + 1, second == string::npos ? string::npos : second - colon - 1);
+            if (name == "FIFO") {
+                device.scheduler = IO_FIFO;
+            } else if (name == "SSTF") {
+                device.scheduler = IO_SHORTEST;
+            } else if (name == "DEADLINE") {
+                device.scheduler = IO_DEADLINE;
+            } else {
+                return false;
+            }
+            if (second != string::npos) {
+                device.expire = strtoll(item.c_str() + second + 1, &end, 10);
+                if (end == item.c_str() + second + 1 || *end || device.expire < 0) {
+                    return false;
+                }
+            }
+        }
+        parsed.push_back(device);
+    }
+    devices = parsed;
+    return true;
+}
+
+static bool endsLater(const IoDevice::Service& a, const IoDevice::Service& b) {
+    return a.end > b.end || (a.end == b.end && a.request.id > b.request.id);
+}
+
+void IoDevice::start(const IoRequest& request, SimTime now) {
+    waits.push_back(now - request.issued);
+    busy += request.service;
+    Service service = {now + request.service, request};
+    serving.push_back(service);
+    push_heap(serving.begin(), serving.end(), endsLater);
+    started.push_back(service);
+}
+
+void IoDevice::submit(const IoRequest& request, SimTime now) {
+    if ((int)serving.size() < config.channels) {
+        start(request, now);
+        return;
+    }
+    long long seq = nextSeq++;
+    queue.emplace(seq, request);
+    byService.insert({request.service, seq});
+}
+
+SimTime IoDevice::nextCompletion() const {
+    return serving.empty() ? NEVER : serving.front().end;
+}
+
+void IoDevice::complete(SimTime t) {
+    while (!serving.empty() && serving.front().end <= t) {
+        SimTime now = serving.front().end;
+        pop_heap(serving.begin(), serving.end(), endsLater);
+        serving.pop_back();
+        if (queue.empty()) {
+            continue;
+        }
+        auto oldest = queue.begin();
+        bool expired = config.scheduler == IO_DEADLINE && now - oldest->second.issued >= config.expire;
+        long long seq = config.scheduler == IO_FIFO || expired ? oldest->first : byService.begin()->second;
+        auto next = queue.find(seq);
+        IoRequest request = next->second;
+        queue.erase(next);
+        byService.erase({request.service, seq});
+        start(request, now);
+    }
+}
+
+SimTime relativeDeadline(const ProcessSpec& process) {
+    if (process.deadline > 0) {
+        return process.deadline;
+    }
+    return process.period > 0 ? process.period : NEVER;
+}
+
+Task startTask(const ProcessSpec& process) {
+    Task task;
+    int first;
+    if (task.cursor.next(process, first)) {
+        task.remaining = first;
+    }
+    SimTime deadline = relativeDeadline(process);
+    if (deadline != NEVER) {
+        task.deadline = process.arrival + deadline;
+    }
+    return task;
+}
+
+bool hasThreads(Span<ProcessSpec> processes) {
+    for (const ProcessSpec& p : processes) {
+        if (p.threads > 1) {
+            return true;
+        }
+    }
+    return false;
+}
+
+ThreadLayout layoutThreads(Span<ProcessSpec> processes) {
+    ThreadLayout layout;
+    for (size_t i = 0; i < processes.size(); i++) {
+        layout.first.push_back(layout.tasks.size());
+        for (int k = 0; k < processes[i].threads; k++) {
+            layout.tasks.push_back(threadSpec(processes[i], k));
+            layout.owner.push_back(i);
+        }
+    }
+    layout.first.push_back(layout.tasks.size());
+    return layout;
+}
+
+static bool runsAfter(const ReadyEntry& a, const ReadyEntry& b) {
+    return a.key > b.key || (a.key == b.key && a.seq > b.seq);
+}
+
+static bool wakesAfter(const IoWake& a, const IoWake& b) {
+    return a.time > b.time || (a.time == b.time && a.seq > b.seq);
+}
+
+GroupTree buildGroupTree(Span<ProcessSpec> processes) {
+    GroupTree tree;
+    tree.path.push_back("/");
+    tree.parent.push_back(-1);
+    tree.weight.push_back(DEFAULT_WEIGHT);
+    unordered_map<string, int> nodes;
+    vector<bool> weightGiven(1, false);
+
+    for (const ProcessSpec& p : processes) {
+        int node = 0;
+        if (p.group) {
+            string path;
+            const char* text = p.group;
+            while (*text) {
+                const char* end = text;
+                while (*end && *end != '/') {
+                    end++;
+                }
+                string component(text, end);
+                text = *end ? end + 1 : end;
+                if (component.empty()) {
+                    continue;
+                }
+                size_t colon = component.find(':');
+                int weight = colon == string::npos ? 0 : atoi(component.c_str() + colon + 1);
+                path += "/" + component.substr(0, colon);
+
+                auto found = nodes.find(path);
+                int child;
+                if (found == nodes.end()) {
+                    child = tree.path.size();
+                    nodes.emplace(path, child);
+                    tree.path.push_back(path);
+                    tree.parent.push_back(node);
+                    tree.weight.push_back(DEFAULT_WEIGHT);
+                    weightGiven.push_back(false);
+                } else {
+                    child = found->second;
+                }
+                if (weight > 0 && !weightGiven[child]) {
+                    tree.weight[child] = weight;
+                    weightGiven[child] = true;
+                    tree.weighted = true;
+                }
+                node = child;
+            }
+        }
+        tree.processGroup.push_back(node);
+        tree.processWeight.push_back(p.weight > 0 ? p.weight : DEFAULT_WEIGHT);
+        tree.weighted = tree.weighted || p.weight > 0;
+    }
+    return tree;
+}
+
+// CFS virtual time: a default-weight entity advances 1024 per time unit
+static SimTime weightedRuntime(SimTime ran, int weight) {
+    return ran * 1024 * DEFAULT_WEIGHT / weight;
+}
+
+void ReadyQueue::useLevels(int n) {
+    fifo = false;
+    levels.assign(n, {});
+    levelBits.assign((n + 63) / 64, 0);
+    levelWords.assign((levelBits.size() + 63) / 64, 0);
+    levelCount = 0;
+}
+
+void ReadyQueue::useGroups(const GroupTree* groupTree) {
+    fifo = false;
+    tree = groupTree;
+    groups.assign(tree->path.size(), {});
+    groupCount = 0;
+}
+
+// Queue a group that just got something runnable below it, and the groups
+// above it that were empty
+void ReadyQueue::queueGroup(int group) {
+    while (group != 0 && !groups[group].queued && !groups[group].current) {
+        GroupQueue& node = groups[group];
+        GroupQueue& parent = groups[tree->parent[group]];
+        // Like a waking task, a group must not bank the time it was empty
+        node.vruntime = max(node.vruntime, parent.minVruntime);
+        node.seq = groupSeq++;
+        parent.heap.push_back({node.vruntime, node.seq, ~group});
+        push_heap(parent.heap.begin(), parent.heap.end(), runsAfter);
+        node.queued = true;
+        group = tree->parent[group];
+    }
+}
+
+void ReadyQueue::chargeGroups(int id, SimTime ran) {
+    for (int group = tree->processGroup[id]; group != 0; group = tree->parent[group]) {
+        GroupQueue& node = groups[group];
+        node.vruntime += weightedRuntime(ran, tree->weight[group]);
+        node.current = false;
+        node.currentChild = -1;
+        if (!node.heap.empty()) {
+            GroupQueue& parent = groups[tree->parent[group]];
+            parent.heap.push_back({node.vruntime, node.seq, ~group});
+            push_heap(parent.heap.begin(), parent.heap.end(), runsAfter);
+            node.queued = true;
+        }
+    }
+    groups[0].currentChild = -1;
+}
+
+void ReadyQueue::markLevel(int level, bool nonEmpty) {
+    size_t word = level / 64;
+    unsigned long long bit = 1ULL << (level % 64);
+    levelBits[word] = nonEmpty ? levelBits[word] | bit : levelBits[word] & ~bit;
+    unsigned long long summaryBit = 1ULL << (word % 64);
+    unsigned long long& summary = levelWords[word / 64];
+    summary = levelBits[word] ? summary | summaryBit : summary & ~summaryBit;
+}
+
+int ReadyQueue::firstLevel() const {
+    for (size_t w = 0; w < levelWords.size(); w++) {
+        if (levelWords[w]) {
+            size_t word = w * 64 + __builtin_ctzll(levelWords[w]);
+            return word * 64 + __builtin_ctzll(levelBits[word]);
+        }
+    }
+    return -1;
+}
+
+void ReadyQueue::push(int id, SimTime key, long long seq) {
+    if (fifo) {
+        order.push_back(id);
+        return;
+    }
+    if (!levels.empty()) {
+        // A level stays sorted by seq: only a preempted task, which ran
+        // before everything queued behind it, goes back to the front
+        deque<ReadyEntry>& level = levels[key];
+        if (level.empty()) {
+            markLevel(key, true);
+        }
+        if (!level.empty() && seq < level.front().seq) {
+            level.push_front({key, seq, id});
+        } else {
+            level.push_back({key, seq, id});
+        }
+        levelCount++;
+        return;
+    }
+    if (tree) {
+        int group = tree->processGroup[id];
+        vector<ReadyEntry>& queue = groups[group].heap;
+        queue.push_back({key, seq, id});
+        push_heap(queue.begin(), queue.end(), runsAfter);
+        groupCount++;
+        queueGroup(group);
+        return;
+    }
+    heap.push_back({key, seq, id});
+    push_heap(heap.begin(), heap.end(), runsAfter);
+}
+
+int ReadyQueue::pop() {
+    if (fifo) {
+        int id = order.front();
+        order.pop_front();
+        return id;
+    }
+    if (!levels.empty()) {
+        int l = firstLevel();
+        int id = levels[l].front().id;
+        levels[l].pop_front();
+        if (levels[l].empty()) {
+            markLevel(l, false);
+        }
+        levelCount--;
+        return id;
+    }
+    if (tree) {
+        // Walk down the smallest vruntimes, taking the groups on the way out
+        // of their parents until the task stops running
+        int group = 0;
+        while (true) {
+            GroupQueue& node = groups[group];
+            pop_heap(node.heap.begin(), node.heap.end(), runsAfter);
+            ReadyEntry entry = node.heap.back();
+            node.heap.pop_back();
+            node.minVruntime = max(node.minVruntime, entry.key);
+            if (entry.id >= 0) {
+                groupCount--;
+                return entry.id;
+            }
+            node.currentChild = ~entry.id;
+            group = ~entry.id;
+            groups[group].queued = false;
+            groups[group].current = true;
+        }
+    }
+    pop_heap(heap.begin(), heap.end(), runsAfter);
+    int id = heap.back().id;
+    heap.pop_back();
+    return id;
+}
+
+SimTime ReadyQueue::topKey() const {
+    return levels.empty() ? heap.front().key : firstLevel();
+}
+
+int ReadyQueue::steal() {
+    if (fifo) {
+        int id = order.back();
+        order.pop_back();
+        return id;
+    }
+    if (!levels.empty()) {
+        for (size_t w = levelWords.size(); w-- > 0;) {
+            if (levelWords[w]) {
+                size_t word = w * 64 + 63 - __builtin_clzll(levelWords[w]);
+                int l = word * 64 + 63 - __builtin_clzll(levelBits[word]);
+                int id = levels[l].back().id;
+                levels[l].pop_back();
+                if (levels[l].empty()) {
+                    markLevel(l, false);
+                }
+                levelCount--;
+                return id;
+            }
+        }
+    }
+    if (tree) {
+        // Follow the last leaves down, or the running path where a group
+        // has nothing queued of its own
+        int group = 0;
+        while (true) {
+            GroupQueue& node = groups[group];
+            if (node.heap.empty()) {
+                group = node.currentChild;
+                continue;
+            }
+            ReadyEntry entry = node.heap.back();
+            if (entry.id < 0) {
+                group = ~entry.id;
+                continue;
+            }
+            node.heap.pop_back();
+            groupCount--;
+            // Groups left empty were the last leaf of their parents
+            while (group != 0 && groups[group].heap.empty() && groups[group].queued) {
+                groups[group].queued = false;
+                group = tree->parent[group];
+                groups[group].heap.pop_back();
+            }
+            return entry.id;
+        }
+    }
+    // Dropping the last leaf keeps the heap property
+    int id = heap.back().id;
+    heap.pop_back();
+    return id;
+}
+
+SimTime Cpu::nextEvent() const {
+    SimTime t = NEVER;
+    if (running >= 0) {
+        t = runEnd;
+    }
+    if (nextArrival < arrivals.size()) {
+        t = min(t, processes[arrivals[nextArrival]].arrival);
+    }
+    if (!io.empty()) {
+        t = min(t, io.front().time);
+    }
+    if (devices && !batchIo) {
+        for (const IoDevice& device : *devices) {
+            t = min(t, device.nextCompletion());
+        }
+    }
+    return t;
+}
+
+SimTime Cpu::vruntimeFloor(int id) const {
+    return ready.tree ? ready.groups[ready.tree->processGroup[id]].minVruntime : minVruntime;
+}
+
+SimTime Cpu::readyKey(const Task& task) const {
+    switch (policy) {
+    case POLICY_SJF:
+    case POLICY_SRTF: return task.remaining;
+    case POLICY_CFS: return task.vruntime;
+    case POLICY_EDF: return task.deadline;
+    case POLICY_RM: return task.priority;
+    default: return 0;
+    }
+}
+
+// A task as a policy plugin sees it
+static sched_task pluginTask(const Cpu& cpu, int id) {
+    const Task& task = (*cpu.tasks)[id];
+    const ProcessSpec& process = cpu.processes[id];
+    return {id, task.burst, process.arrival, task.remaining,
+            task.deadline == NEVER ? SCHED_NO_DEADLINE : task.deadline, process.period};
+}
+
+// Leave a hole in members, so it stays in enqueue order, and compact once
+// holes make up half of it
+static void unqueue(PluginQueue& queue, int id) {
+    vector<int>& members = queue.members;
+    members[queue.position[id]] = -1;
+    queue.position[id] = -1;
+    queue.count--;
+    while (!members.empty() && members.back() < 0) {
+        members.pop_back();
+    }
+    while (queue.head < members.size() && members[queue.head] < 0) {
+        queue.head++;
+    }
+    if (members.size() >= 2 * queue.count + 64) {
+        size_t kept = 0;
+        for (size_t i = queue.head; i < members.size(); i++) {
+            if (members[i] >= 0) {
+                queue.position[members[i]] = kept;
+                members[kept++] = members[i];
+            }
+        }
+        members.resize(kept);
+        queue.head = 0;
+    }
+}
+
+void Cpu::enqueue(int id, bool keepSeq) {
+    Task& task = (*tasks)[id];
+    if (plugin.api) {
+        // Tasks back from I/O since they last ran go to the wake hook
+        if (plugin.position.size() <= (size_t)id) {
+            plugin.position.resize(tasks->size(), -1);
+        }
+        if (plugin.count == 0) {
+            plugin.members.clear();
+            plugin.head = 0;
+        }
+        plugin.position[id] = plugin.members.size();
+        plugin.members.push_back(id);
+        plugin.count++;
+        (task.cold ? plugin.woken : plugin.enqueued).push_back(pluginTask(*this, id));
+        return;
+    }
+    if (!keepSeq) {
+        task.seq = nextSeq++;
+    }
+    if (policy == POLICY_CFS) {
+        // A waking task must not bank the time it spent blocked
+        task.vruntime = max(task.vruntime, vruntimeFloor(id));
+    }
+    ready.push(id, readyKey(task), task.seq);
+}
+
+int Cpu::steal() {
+    if (!plugin.api) {
+        return ready.steal();
+    }
+    // The most recently queued task, which has waited the least
+    int id = plugin.members.back();
+    unqueue(plugin, id);
+    // One stolen at this balancing point has not reached the plugin yet
+    for (vector<sched_task>* batch : {&plugin.enqueued, &plugin.woken}) {
+        if (!batch->empty() && batch->back().id == id) {
+            batch->pop_back();
+            return id;
+        }
+    }
+    plugin.api->dequeue(plugin.state, now, &id, 1);
+    plugin.calls++;
+    return id;
+}
+
+bool Cpu::flushPlugin() {
+    bool preempt = false;
+    if (!plugin.enqueued.empty()) {
+        preempt |= plugin.api->enqueue(plugin.state, now, plugin.enqueued.data(), plugin.enqueued.size()) != 0;
+        plugin.calls++;
+        plugin.enqueued.clear();
+    }
+    if (!plugin.woken.empty()) {
+        auto wake = plugin.api->wake ? plugin.api->wake : plugin.api->enqueue;
+        preempt |= wake(plugin.state, now, plugin.woken.data(), plugin.woken.size()) != 0;
+        plugin.calls++;
+        plugin.woken.clear();
+    }
+    return preempt;
+}
+
+// Remove the oldest sample once the ring is full, then add the new one
+template <typename T, typename Sum>
+static void slide(vector<T>& ring, size_t& next, size_t& count, Sum& sum, T value) {
+    if (count == ring.size()) {
+        sum -= ring[next];
+    } else {
+        count++;
+    }
+    ring[next] = value;
+    sum += value;
+    next = (next + 1) % ring.size();
+}
+
+void Cpu::observeBurst(SimTime length) {
+    AdaptiveWindow& w = window;
+    if (w.burstCount == w.bursts.size()) {
+        SimTime oldest = w.bursts[w.nextBurst];
+        w.burstSquares -= (double)oldest * oldest;
+        w.shortBursts -= oldest <= quantum;
+    }
+    w.burstSquares += (double)length * length;
+    w.shortBursts += length <= quantum;
+    slide(w.bursts, w.nextBurst, w.burstCount, w.burstSum, length);
+}
+
+static double windowDepth(const AdaptiveWindow& w) {
+    return w.depthCount > 0 ? (double)w.depthSum / w.depthCount : 0.0;
+}
+
+static double windowVariation(const AdaptiveWindow& w) {
+    if (w.burstCount == 0 || w.burstSum <= 0) {
+        return 0.0;
+    }
+    double mean = (double)w.burstSum / w.burstCount;
+    double variance = max(0.0, w.burstSquares / w.burstCount - mean * mean);
+    return sqrt(variance) / mean;
+}
+
+static double windowShort(const AdaptiveWindow& w) {
+    return w.burstCount > 0 ? (double)w.shortBursts / w.burstCount : 0.0;
+}
+
+static bool ruleHolds(const AdaptiveRule& rule, const AdaptiveWindow& w) {
+    double value = 0;
+    switch (rule.metric) {
+    case ADAPT_ALWAYS: return true;
+    case ADAPT_DEPTH: value = windowDepth(w); break;
+    case ADAPT_VARIATION: value = windowVariation(w); break;
+    case ADAPT_SHORT: value = windowShort(w); break;
+    }
+    if (rule.op == "<") {
+        return value < rule.threshold;
+    } else if (rule.op == "<=") {
+        return value <= rule.threshold;
+    } else if (rule.op == ">") {
+        return value > rule.threshold;
+    }
+    return value >= rule.threshold;
+}
+
+// First rule that holds on the window, or the current discipline if none does
+static Policy adaptiveChoice(const AdaptiveConfig& config, const AdaptiveWindow& w, Policy current) {
+    for (const AdaptiveRule& rule : config.rules) {
+        if (ruleHolds(rule, w)) {
+            return rule.policy;
+        }
+    }
+    return current;
+}
+
+void Cpu::useAdaptive(const AdaptiveConfig* config) {
+    adaptive = config;
+    int size = max(1, config->window);
+    window = AdaptiveWindow();
+    window.depths.assign(size, 0);
+    window.bursts.assign(size, 0);
+    // FIFO and RR run on the heap too, with equal keys so seq keeps arrival order
+    ready.fifo = false;
+    policy = adaptiveChoice(*config, window, POLICY_FIFO);
+}
+
+void Cpu::switchPolicy(Policy next) {
+    switches.push_back({now, 0, policy, next, windowDepth(window), windowVariation(window), windowShort(window)});
+    policy = next;
+    for (ReadyEntry& entry : ready.heap) {
+        entry.key = readyKey((*tasks)[entry.id]);
+    }
+    make_heap(ready.heap.begin(), ready.heap.end(), runsAfter);
+}
+
+void Cpu::dispatch() {
+    if (adaptive) {
+        slide(window.depths, window.nextDepth, window.depthCount, window.depthSum, (int)ready.size());
+        if (++window.dispatches % window.depths.size() == 0) {
+            Policy next = adaptiveChoice(*adaptive, window, policy);
+            if (next != policy) {
+                switchPolicy(next);
+            }
+        }
+    }
+    int id;
+    long long pluginSlice = 0;
+    if (plugin.api) {
+        flushPlugin();
+        id = plugin.api->pick_next(plugin.state, now, &pluginSlice);
+        plugin.calls++;
+        if (id < 0 || id >= (int)plugin.position.size() || plugin.position[id] < 0) {
+            // Run the longest-queued task and take it out of the plugin's queue
+            id = plugin.members[plugin.head];
+            unqueue(plugin, id);
+            plugin.api->dequeue(plugin.state, now, &id, 1);
+            plugin.calls++;
+        } else {
+            unqueue(plugin, id);
+        }
+    } else {
+        id = ready.pop();
+    }
+    Task& task = (*tasks)[id];
+    SimTime cost = 0;
+    if (id != lastRun) {
+        cost += costs.contextSwitch;
+        contextSwitches++;
+    }
+    cost += (task.migrated ? costs.migration : 0) + (task.cold ? costs.cacheCold : 0);
+    task.migrated = false;
+    task.cold = false;
+    running = id;
+    lastRun = id;
+    runStart = now;
+    overheadEnd = now + cost;
+    SimTime slice = task.remaining;
+    if (policy == POLICY_RR || policy == POLICY_CFS) {
+        slice = min(slice, quantum);
+    } else if (pluginSlice > 0) {
+        slice = min(slice, pluginSlice);
+    }
+    runEnd = overheadEnd + slice;
+    if (policy == POLICY_CFS) {
+        minVruntime = max(minVruntime, task.vruntime);
+    }
+    logDecision(id, DECISION_RUN);
+}
+
+// Work done by the running task so far, after its switch overhead
+static SimTime workDone(const Cpu& cpu) {
+    return max<SimTime>(0, cpu.now - cpu.overheadEnd);
+}
+
+// Charge the running task for the time since it was dispatched. Overhead
+// cut short by a preemption is lost.
+static void chargeRunning(Cpu& cpu) {
+    Task& task = (*cpu.tasks)[cpu.running];
+    SimTime ran = cpu.now - cpu.runStart;
+    task.remaining -= workDone(cpu);
+    cpu.busy += ran;
+    cpu.overhead += min(cpu.now, cpu.overheadEnd) - cpu.runStart;
+    if (cpu.ready.tree) {
+        task.vruntime += weightedRuntime(ran, cpu.ready.tree->processWeight[cpu.running]);
+        cpu.ready.chargeGroups(cpu.running, ran);
+    } else {
+        task.vruntime += ran;
+    }
+    if (ran > 0 && cpu.recordSchedule) {
+        cpu.schedule.push_back({cpu.runStart, cpu.now, cpu.running, task.burst});
+    }
+}
+
+void Cpu::endSlice() {
+    if (plugin.api && plugin.api->tick) {
+        // A plugin slice ran out before the burst: the plugin may extend it
+        sched_task view = pluginTask(*this, running);
+        view.remaining -= workDone(*this);
+        if (view.remaining > 0) {
+            long long slice = plugin.api->tick(plugin.state, now, &view);
+            plugin.calls++;
+            if (slice > 0) {
+                runEnd = now + min<SimTime>(view.remaining, slice);
+                return;
+            }
+        }
+    }
+    chargeRunning(*this);
+    int id = running;
+    running = -1;
+    Task& task = (*tasks)[id];
+    if (task.remaining > 0) {
+        logDecision(id, DECISION_PREEMPT);
+        enqueue(id, false);
+        return;
+    }
+
+    if (task.deadline != NEVER) {
+        lateness.push_back(now - task.deadline);
+    }
+    const ProcessSpec& process = processes[id];
+    task.burst++;
+    int ioBurst, cpuBurst;
+    if (task.cursor.next(process, ioBurst) && task.cursor.next(process, cpuBurst)) {
+        // The next job of a periodic process waits for its release
+        SimTime wake = now + ioBurst;
+        SimTime release = wake;
+        if (process.period > 0) {
+            release = process.arrival + task.burst * process.period;
+            wake = max(wake, release);
+        }
+        SimTime deadline = relativeDeadline(process);
+        task.deadline = deadline == NEVER ? NEVER : release + deadline;
+        if (process.device >= 0 && devices) {
+            // The wake and, for an aperiodic job, the deadline follow the device
+            IoRequest request = {now, ioBurst, process.period > 0 ? release : 0, id, index, process.device};
+            if (batchIo) {
+                outbox.push_back(request);
+            } else {
+                IoDevice& device = (*devices)[process.device];
+                device.submit(request, now);
+                for (const IoDevice::Service& service : device.started) {
+                    wakeAfterIo(service, now);
+                }
+                device.started.clear();
+            }
+        } else {
+            io.push_back({wake, nextIoSeq++, id});
+            push_heap(io.begin(), io.end(), wakesAfter);
+        }
+        task.remaining = cpuBurst;
+        task.cold = true;
+        blocked++;
+        logDecision(id, DECISION_BLOCK);
+    } else {
+        task.completed = true;
+        task.completion = now;
+        completed++;
+        if (series.width > 0) {
+            series.complete(now, now - process.arrival - totalCpuTime(process));
+        }
+        logDecision(id, DECISION_EXIT);
+    }
+}
+
+void Cpu::wakeAfterIo(const IoDevice::Service& service, SimTime earliest) {
+    const IoRequest& request = service.request;
+    const ProcessSpec& process = processes[request.id];
+    Task& task = (*tasks)[request.id];
+    SimTime release = max(service.end, request.release);
+    if (process.period == 0) {
+        SimTime deadline = relativeDeadline(process);
+        task.deadline = deadline == NEVER ? NEVER : release + deadline;
+    }
+    io.push_back({max(release, earliest), nextIoSeq++, request.id});
+    push_heap(io.begin(), io.end(), wakesAfter);
+}
+
+void Cpu::preempt() {
+    chargeRunning(*this);
+    int id = running;
+    running = -1;
+    logDecision(id, DECISION_PREEMPT);
+    enqueue(id, true);
+}
+
+void Cpu::advance(SimTime until) {
+    while (true) {
+        SimTime t = nextEvent();
+        if (running < 0 && queued() > 0) {
+            t = now;  // Work handed over at a balancing point
+        }
+        if (t >= until) {
+            break;
+        }
+        if (series.width > 0) {
+            series.observe(t, running >= 0, queued(), blocked);
+        }
+        now = t;
+
+        if (running >= 0 && runEnd == now) {
+            endSlice();
+        }
+        while (nextArrival < arrivals.size() && processes[arrivals[nextArrival]].arrival <= now) {
+            int id = arrivals[nextArrival++];
+            if (adaptive) {
+                observeBurst((*tasks)[id].remaining);
+            }
+            enqueue(id, false);
+        }
+        if (devices && !batchIo) {
+            for (IoDevice& device : *devices) {
+                device.complete(now);
+                for (const IoDevice::Service& service : device.started) {
+                    wakeAfterIo(service, now);
+                }
+                device.started.clear();
+            }
+        }
+        while (!io.empty() && io.front().time <= now) {
+            pop_heap(io.begin(), io.end(), wakesAfter);
+            int id = io.back().id;
+            io.pop_back();
+            blocked--;
+            if (adaptive) {
+                observeBurst((*tasks)[id].remaining);
+            }
+            enqueue(id, false);
+        }
+
+        if (plugin.api && flushPlugin() && running >= 0) {
+            preempt();
+        }
+        if ((policy == POLICY_SRTF || policy == POLICY_EDF || policy == POLICY_RM) && running >= 0 &&
+            !ready.empty()) {
+            const Task& task = (*tasks)[running];
+            SimTime key = policy == POLICY_SRTF ? task.remaining - workDone(*this) : readyKey(task);
+            if (ready.topKey() < key) {
+                preempt();
+            }
+        }
+        if (running < 0 && queued() > 0) {
+            dispatch();
+        }
+    }
+    if (until != NEVER && now < until) {
+        if (series.width > 0) {
+            series.observe(until, running >= 0, queued(), blocked);
+        }
+        now = until;
+    }
+}
+
+// Reusable barrier for the host threads driving the CPUs
+class HostBarrier {
+public:
+    explicit HostBarrier(int count) : count(count) {}
+
+    void wait() {
+        unique_lock<mutex> lock(m);
+        long long gen = generation;
+        if (++arrived == count) {
+            arrived = 0;
+            generation++;
+            cv.notify_all();
+        } else {
+            cv.wait(lock, [&] { return gen != generation; });
+        }
+    }
+
+private:
+    mutex m;
+    condition_variable cv;
+    int count;
+    int arrived = 0;
+    long long generation = 0;
+};
+
+static CpuCheckpoint saveCpu(const Cpu& cpu) {
+    return {cpu.now, cpu.running, cpu.runStart, cpu.runEnd, cpu.minVruntime, cpu.nextSeq, cpu.lastRun,
+            cpu.overheadEnd, cpu.ready, cpu.io, cpu.nextIoSeq, cpu.busy, cpu.completed, cpu.migrations, cpu.contextSwitches,
+            cpu.overhead, cpu.schedule.size(), cpu.lateness.size(),
+            cpu.policy, cpu.window, cpu.switches.size()};
+}
+
+static EngineCheckpoint saveCheckpoint(SimTime time, const vector<Cpu>& cpus, const vector<Task>& tasks,
+                                       const vector<IoDevice>& devices) {
+    EngineCheckpoint checkpoint;
+    checkpoint.time = time;
+    for (const IoDevice& device : devices) {
+        checkpoint.waitsSize.push_back(device.waits.size());
+        checkpoint.devices.push_back(device);
+        checkpoint.devices.back().waits.clear();
+        // Requests in service already have their wake on a CPU
+        for (const pair<const long long, IoRequest>& waiting : device.queue) {
+            checkpoint.active.push_back({waiting.second.id, tasks[waiting.second.id]});
+        }
+    }
+    for (const Cpu& cpu : cpus) {
+        checkpoint.cpus.push_back(saveCpu(cpu));
+        if (cpu.running >= 0) {
+            checkpoint.active.push_back({cpu.running, tasks[cpu.running]});
+        }
+        for (int id : cpu.ready.order) {
+            checkpoint.active.push_back({id, tasks[id]});
+        }
+        for (const ReadyEntry& entry : cpu.ready.heap) {
+            checkpoint.active.push_back({entry.id, tasks[entry.id]});
+        }
+        for (const deque<ReadyEntry>& level : cpu.ready.levels) {
+            for (const ReadyEntry& entry : level) {
+                checkpoint.active.push_back({entry.id, tasks[entry.id]});
+            }
+        }
+        for (const GroupQueue& group : cpu.ready.groups) {
+            for (const ReadyEntry& entry : group.heap) {
+                if (entry.id >= 0) {
+                    checkpoint.active.push_back({entry.id, tasks[entry.id]});
+                }
+            }
+        }
+        for (const IoWake& wake : cpu.io) {
+            checkpoint.active.push_back({wake.id, tasks[wake.id]});
+        }
+    }
+    return checkpoint;
+}
+
+static size_t checkpointSize(const EngineCheckpoint& checkpoint) {
+    size_t bytes = sizeof(checkpoint) + checkpoint.active.size() * sizeof(checkpoint.active[0]);
+    for (const IoDevice& device : checkpoint.devices) {
+        // A map and a set node per waiting request
+        bytes += device.queue.size() * (sizeof(IoRequest) + 96) + device.serving.size() * sizeof(device.serving[0]);
+    }
+    for (const CpuCheckpoint& cpu : checkpoint.cpus) {
+        bytes += sizeof(cpu) + cpu.ready.order.size() * sizeof(int) +
+                 (cpu.ready.heap.size() + cpu.ready.levelCount) * sizeof(ReadyEntry) +
+                 cpu.ready.levels.size() * sizeof(cpu.ready.levels[0]) + cpu.io.size() * sizeof(cpu.io[0]) +
+                 cpu.ready.groups.size() * sizeof(GroupQueue) + cpu.ready.groupCount * sizeof(ReadyEntry);
+    }
+    return bytes;
+}
+
+// Drive the CPUs window by window, from the start or from `resume`
+static MultiCpuResult runCpus(Span<ProcessSpec> workload, Policy policy, int quantum, const MultiCpuConfig& config,
+                              vector<EngineCheckpoint>* checkpoints, const EngineCheckpoint* resume,
+                              const MultiCpuResult* prefix) {
+    // Multi-threaded processes run as one task per thread; below, a
+    // "process" is a task
+    bool threaded = hasThreads(workload);
+    // The ready queues of a plugin live in its state, which cannot be
+    // saved, and telemetry windows may straddle a checkpoint
+    if (policy == POLICY_PLUGIN || config.telemetryWindow > 0) {
+        checkpoints = nullptr;
+    }
+    ThreadLayout layout;
+    if (threaded) {
+        layout = layoutThreads(workload);
+    }
+    Span<ProcessSpec> processes = threaded ? Span<ProcessSpec>(layout.tasks) : workload;
+    int numProcesses = processes.size();
+    int numCpus = max(1, config.cpus);
+    int numThreads = min(max(1, config.threads), numCpus);
+    // A single CPU has nobody to balance with, so it runs as one window,
+    // or in checkpoint-sized windows when checkpoints are taken. Interval 0
+    // derives each window from the CPUs' next events (see balance below).
+    SimTime interval = max<SimTime>(0, config.balanceInterval);
+    if (numCpus == 1) {
+        interval = checkpoints ? max<SimTime>(1, config.checkpointInterval) : NEVER;
+    }
+
+    vector<Task> tasks(numProcesses);
+    for (int i = 0; i < numProcesses; i++) {
+        tasks[i] = startTask(processes[i]);
+    }
+
+    // Processes without groups or weights keep the flat CFS run queue
+    GroupTree tree;
+    bool grouped = false;
+    if (policy == POLICY_CFS) {
+        tree = buildGroupTree(processes);
+        grouped = tree.grouped();
+    }
+
+    // Rate-monotonic levels rank the distinct periods; aperiodic processes come last
+    vector<SimTime> periods;
+    if (policy == POLICY_RM) {
+        for (const ProcessSpec& p : processes) {
+            if (p.period > 0) {
+                periods.push_back(p.period);
+            }
+        }
+        sort(periods.begin(), periods.end());
+        periods.erase(unique(periods.begin(), periods.end()), periods.end());
+        for (int i = 0; i < numProcesses; i++) {
+            SimTime period = processes[i].period > 0 ? processes[i].period : NEVER;
+            tasks[i].priority = lower_bound(periods.begin(), periods.end(), period) - periods.begin();
+        }
+    }
+
+    vector<IoDevice> devices(config.devices.size());
+    for (size_t d = 0; d < devices.size(); d++) {
+        devices[d].config = config.devices[d];
+    }
+
+    vector<Cpu> cpus(numCpus);
+    for (int c = 0; c < numCpus; c++) {
+        Cpu& cpu = cpus[c];
+        cpu.index = c;
+        if (!devices.empty()) {
+            cpu.devices = &devices;
+            cpu.batchIo = numCpus > 1;
+        }
+        cpu.policy = policy;
+        cpu.quantum = max(1, quantum);
+        cpu.recordSchedule = config.recordSchedule;
+        cpu.costs = config.costs;
+        cpu.processes = processes.data();
+        cpu.tasks = &tasks;
+        cpu.ready.fifo = (policy == POLICY_FIFO || policy == POLICY_RR);
+        if (policy == POLICY_RM) {
+            cpu.ready.useLevels(periods.size() + 1);
+        }
+        if (grouped) {
+            cpu.ready.useGroups(&tree);
+        }
+        if (policy == POLICY_ADAPTIVE) {
+            cpu.useAdaptive(config.adaptive.rules.empty() ? &defaultAdaptiveConfig() : &config.adaptive);
+        }
+        cpu.series.width = config.telemetryWindow;
+        if (policy == POLICY_PLUGIN) {
+            cpu.plugin.api = config.plugin;
+            cpu.plugin.state = config.plugin->create ? config.plugin->create(max(1, quantum)) : nullptr;
+        }
+    }
+
+    vector<int> arrivalOrder(numProcesses);
+    iota(arrivalOrder.begin(), arrivalOrder.end(), 0);
+    stable_sort(arrivalOrder.begin(), arrivalOrder.end(),
+                [&](int a, int b) { return processes[a].arrival < processes[b].arrival; });
+    int nextPlacement = 0;
+
+    SimTime windowEnd = 0;
+    SimTime checkpointInterval = max<SimTime>(1, config.checkpointInterval);
+    SimTime nextCheckpoint = 0;
+    size_t checkpointBytes = 0;
+    bool finished = (numProcesses == 0);
+
+    if (resume) {
+        // Every process arriving before the checkpoint was placed; the ones
+        // not active any more completed as in the prefix run
+        windowEnd = resume->time;
+        while (nextPlacement < numProcesses && processes[arrivalOrder[nextPlacement]].arrival < windowEnd) {
+            int id = arrivalOrder[nextPlacement++];
+            tasks[id].completed = true;
+            // A finished thread ended before the checkpoint, by when its
+            // process may not have
+            tasks[id].completion = threaded ? min(prefix->completion[layout.owner[id]], windowEnd)
+                                            : prefix->completion[id];
+        }
+        for (const pair<int, Task>& active : resume->active) {
+            tasks[active.first] = active.second;
+        }
+        for (int c = 0; c < numCpus; c++) {
+            const CpuCheckpoint& saved = resume->cpus[c];
+            Cpu& cpu = cpus[c];
+            cpu.now = saved.now;
+            cpu.running = saved.running;
+            cpu.runStart = saved.runStart;
+            cpu.runEnd = saved.runEnd;
+            cpu.minVruntime = saved.minVruntime;
+            cpu.nextSeq = saved.nextSeq;
+            cpu.lastRun = saved.lastRun;
+            cpu.overheadEnd = saved.overheadEnd;
+            cpu.ready = saved.ready;
+            cpu.ready.tree = grouped ? &tree : nullptr;
+            cpu.io = saved.io;
+            cpu.nextIoSeq = saved.nextIoSeq;
+            cpu.busy = saved.busy;
+            cpu.completed = saved.completed;
+            cpu.migrations = saved.migrations;
+            cpu.contextSwitches = saved.contextSwitches;
+            cpu.overhead = saved.overhead;
+            if (config.recordSchedule) {
+                const vector<Segment>& schedule = prefix->schedule[c];
+                cpu.schedule.assign(schedule.begin(), schedule.begin() + saved.scheduleSize);
+            }
+            const vector<SimTime>& lateness = prefix->lateness[c];
+            cpu.lateness.assign(lateness.begin(), lateness.begin() + saved.latenessSize);
+            cpu.policy = saved.policy;
+            cpu.window = saved.window;
+            cpu.switches.clear();
+            for (const PolicySwitch& change : prefix->switches) {
+                if (change.cpu == c && cpu.switches.size() < saved.switchesSize) {
+                    cpu.switches.push_back(change);
+                }
+            }
+        }
+        for (size_t d = 0; d < devices.size(); d++) {
+            devices[d] = resume->devices[d];
+            const vector<SimTime>& waits = prefix->deviceWaits[d];
+            devices[d].waits.assign(waits.begin(), waits.begin() + resume->waitsSize[d]);
+        }
+    }
+
+    // With several CPUs, the requests each CPU made during the window reach
+    // the devices in time order. Requests that started early enough keep
+    // their exact end; the rest wake their process at the balancing point.
+    auto serveDevices = [&]() {
+        vector<IoRequest> requests;
+        for (Cpu& cpu : cpus) {
+            requests.insert(requests.end(), cpu.outbox.begin(), cpu.outbox.end());
+            cpu.outbox.clear();
+        }
+        stable_sort(requests.begin(), requests.end(),
+                    [](const IoRequest& a, const IoRequest& b) { return a.issued < b.issued; });
+        for (const IoRequest& request : requests) {
+            IoDevice& device = devices[request.device];
+            device.complete(request.issued - 1);
+            device.submit(request, request.issued);
+        }
+        for (IoDevice& device : devices) {
+            device.complete(windowEnd - 1);
+            for (const IoDevice::Service& service : device.started) {
+                cpus[service.request.cpu].wakeAfterIo(service, windowEnd);
+            }
+            device.started.clear();
+        }
+    };
+
+    // Runs on one thread while all CPUs are stopped at windowEnd
+    auto balance = [&]() {
+        if (numCpus > 1 && !devices.empty()) {
+            serveDevices();
+        }
+        int done = 0;
+        bool allIdle = true;
+        for (const Cpu& cpu : cpus) {
+            done += cpu.completed;
+            allIdle = allIdle && cpu.idle();
+        }
+        if (done == numProcesses) {
+            finished = true;
+            return;
+        }
+        if (checkpoints && windowEnd >= nextCheckpoint) {
+            if (windowEnd > 0) {
+                checkpoints->push_back(saveCheckpoint(windowEnd, cpus, tasks, devices));
+                checkpointBytes += checkpointSize(checkpoints->back());
+            }
+            if (checkpointBytes > config.checkpointBytes && checkpoints->size() > 1) {
+                // Thin out evenly, keeping the latest
+                vector<EngineCheckpoint> kept;
+                checkpointBytes = 0;
+                for (size_t i = checkpoints->size() % 2 == 0; i < checkpoints->size(); i += 2) {
+                    checkpointBytes += checkpointSize((*checkpoints)[i]);
+                    kept.push_back(move((*checkpoints)[i]));
+                }
+                checkpoints->swap(kept);
+                checkpointInterval *= 2;
+            }
+            nextCheckpoint = windowEnd + checkpointInterval;
+        }
+
+        // Idle CPUs pull the last queued task from the busiest run queue
+        for (int c = 0; c < numCpus; c++) {
+            if (!cpus[c].idle()) {
+                continue;
+            }
+            int victim = -1;
+            for (int v = 0; v < numCpus; v++) {
+                if (v != c && cpus[v].queued() > 0 &&
+                    (victim < 0 || cpus[v].queued() > cpus[victim].queued())) {
+                    victim = v;
+                }
+            }
+            if (victim < 0) {
+                continue;
+            }
+            int id = cpus[victim].steal();
+            tasks[id].vruntime += cpus[c].vruntimeFloor(id) - cpus[victim].vruntimeFloor(id);
+            tasks[id].migrated = true;
+            cpus[c].enqueue(id, false);
+            cpus[c].migrations++;
+            allIdle = false;
+        }
+
+        SimTime windowStart = windowEnd;
+        if (interval == 0) {
+            // CPUs only interact when one of them is idle, when a process
+            // arrives and, with devices, when a request ends. Without an idle
+            // CPU, none can become idle before the shortest remaining slice
+            // ends; with one, the next event anywhere may give it work. The
+            // CPUs first run up to that instant, then through it in a window
+            // of one unit, so balancing happens wherever it would with a
+            // balancing point at every time unit.
+            bool anyIdle = false;
+            for (const Cpu& cpu : cpus) {
+                anyIdle = anyIdle || cpu.idle();
+            }
+            SimTime next = NEVER;
+            for (const Cpu& cpu : cpus) {
+                if (cpu.running < 0 && cpu.queued() > 0) {
+                    next = windowStart;
+                } else if (anyIdle) {
+                    next = min(next, cpu.nextEvent());
+                } else {
+                    next = min(next, cpu.runEnd);
+                }
+            }
+            if (nextPlacement < numProcesses) {
+                next = min(next, processes[arrivalOrder[nextPlacement]].arrival);
+            }
+            for (const IoDevice& device : devices) {
+                next = min(next, device.nextCompletion());
+            }
+            windowEnd = next > windowStart ? next : windowStart + 1;
+        } else if (allIdle) {
+            // Nothing can happen before the next event, so skip the empty stretch
+            SimTime next = NEVER;
+            for (const Cpu& cpu : cpus) {
+                next = min(next, cpu.nextEvent());
+            }
+            if (nextPlacement < numProcesses) {
+                next = min(next, processes[arrivalOrder[nextPlacement]].arrival);
+            }
+            windowStart = max(windowStart, next);
+        }
+        if (interval > 0) {
+            windowEnd = interval == NEVER ? NEVER : windowStart + interval;
+        }
+
+        // Place the window's arrivals on the least loaded CPUs
+        while (nextPlacement < numProcesses && processes[arrivalOrder[nextPlacement]].arrival < windowEnd) {
+            int target = 0;
+            for (int c = 1; c < numCpus; c++) {
+                if (cpus[c].load() < cpus[target].load()) {
+                    target = c;
+                }
+            }
+            cpus[target].arrivals.push_back(arrivalOrder[nextPlacement++]);
+        }
+    };
+
+    HostBarrier barrier(numThreads);
+    auto worker = [&](int tid) {
+        int first = tid * numCpus / numThreads;
+        int last = (tid + 1) * numCpus / numThreads;
+        while (!finished) {
+            for (int c = first; c < last; c++) {
+                cpus[c].advance(windowEnd);
+            }
+            barrier.wait();
+            if (tid == 0) {
+                balance();
+            }
+            barrier.wait();
+        }
+    };
+
+    balance();
+    vector<thread> workers;
+    for (int t = 1; t < numThreads; t++) {
+        workers.emplace_back(worker, t);
+    }
+    worker(0);
+    for (thread& t : workers) {
+        t.join();
+    }
+
+    MultiCpuResult result;
+    result.completion.resize(workload.size());
+    for (int i = 0; i < numProcesses; i++) {
+        SimTime& completion = result.completion[threaded ? layout.owner[i] : i];
+        completion = max(completion, tasks[i].completion);
+        result.makespan = max(result.makespan, tasks[i].completion);
+    }
+    if (threaded && config.recordSchedule) {
+        // Segments name tasks up to here; those taken from the prefix are done
+        for (int c = 0; c < numCpus; c++) {
+            vector<Segment>& schedule = cpus[c].schedule;
+            for (size_t j = resume ? resume->cpus[c].scheduleSize : 0; j < schedule.size(); j++) {
+                Segment& segment = schedule[j];
+                int owner = layout.owner[segment.process];
+                segment.thread = workload[owner].threads > 1 ? segment.process - layout.first[owner] : -1;
+                segment.process = owner;
+            }
+        }
+    }
+    for (Cpu& cpu : cpus) {
+        if (cpu.plugin.api && cpu.plugin.api->destroy) {
+            cpu.plugin.api->destroy(cpu.plugin.state);
+        }
+        result.pluginCalls += cpu.plugin.calls;
+        result.telemetry.merge(cpu.series);
+        result.migrations += cpu.migrations;
+        result.contextSwitches += cpu.contextSwitches;
+        result.overhead += cpu.overhead;
+        result.busy.push_back(cpu.busy);
+        result.schedule.push_back(move(cpu.schedule));
+        result.lateness.push_back(move(cpu.lateness));
+    }
+    for (IoDevice& device : devices) {
+        result.deviceBusy.push_back(device.busy);
+        result.deviceWaits.push_back(move(device.waits));
+    }
+    for (int c = 0; c < numCpus; c++) {
+        for (PolicySwitch& change : cpus[c].switches) {
+            change.cpu = c;
+            result.switches.push_back(change);
+        }
+    }
+    return result;
+}
+
+MultiCpuResult multiCpuScheduling(Span<ProcessSpec> processes, Policy policy, int quantum,
+                                  const MultiCpuConfig& config, vector<EngineCheckpoint>* checkpoints) {
+    if (config.gang) {
+        return gangScheduling(processes, quantum, config);
+    }
+    return runCpus(processes, policy, quantum, config, checkpoints, nullptr, nullptr);
+}
+
+MultiCpuResult resumeMultiCpuScheduling(Span<ProcessSpec> processes, Policy policy, int quantum,
+                                        const MultiCpuConfig& config, const EngineCheckpoint& checkpoint,
+                                        const MultiCpuResult& prefix) {
+    return runCpus(processes, policy, quantum, config, nullptr, &checkpoint, &prefix);
+}
@@ -0,0 +1,483 @@
+#ifndef ENGINE_H
+#define ENGINE_H
+
+#include <deque>
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include "sched_plugin.h"
+#include "telemetry.h"
+#include "workload.h"
+
+const SimTime NEVER = (1LL << 62);
+
+// Bump whenever a change to the engine alters simulation results
+const int ENGINE_VERSION = 4;
+
+enum Policy {
+    POLICY_FIFO, POLICY_SJF, POLICY_SRTF, POLICY_RR, POLICY_CFS, POLICY_EDF, POLICY_RM, POLICY_ADAPTIVE,
+    POLICY_PLUGIN               // Hooks loaded from a shared object (see plugin.h)
+};
+
+// Map a command-line algorithm name (FIFO, SJF, SRTF, RR, CFS, EDF, RM,
+// ADAPTIVE, PLUGIN) to a policy
+bool parsePolicy(const std::string& name, Policy& policy);
+const char* policyName(Policy policy);
+
+// Runtime state of one process inside the engine
+struct Task {
+    int burst = 0;              // Index of the current CPU burst
+    BurstCursor cursor;         // Position after the current CPU burst
+    SimTime remaining = 0;      // Remaining time of the current CPU burst
+    SimTime vruntime = 0;       // Virtual runtime for CFS
+    long long seq = 0;          // Ready-queue tie-break, kept across preemptions
+    SimTime completion = 0;     // Completion time of the process
+    SimTime deadline = NEVER;   // Absolute deadline of the current job
+    int priority = 0;           // Rate-monotonic level, 0 for the shortest period
+    bool completed = false;
+    bool migrated = false;      // Stolen by another CPU since it last ran
+    bool cold = false;          // Back from I/O since it last ran
+};
+
+// Fresh task at the start of its first CPU burst
+Task startTask(const ProcessSpec& process);
+// Deadline of a job relative to its release, NEVER for none
+SimTime relativeDeadline(const ProcessSpec& process);
+
+struct ReadyEntry {
+    SimTime key;
+    long long seq;
+    int id;
+};
+
+// cgroup v2 cpu.weight default, used for groups and processes without one
+const int DEFAULT_WEIGHT = 100;
+
+// Shape of the group hierarchy, shared by all CPUs. Node 0 is the root "/".
+// A path such as "/a:300/b" names nodes "/a" and "/a/b"; ":300" sets the
+// weight of "/a" (the first line that gives one wins).
+struct GroupTree {
+    std::vector<std::string> path;
+    std::vector<int> parent;            // -1 for the root
+    std::vector<int> weight;
+    std::vector<int> processGroup;      // Leaf node of every process
+    std::vector<int> processWeight;
+    bool weighted = false;              // Any group or process weight given
+
+    bool grouped() const { return path.size() > 1 || weighted; }
+};
+
+GroupTree buildGroupTree(Span<ProcessSpec> processes);
+
+// CFS run queue of one group node on one CPU. Children are tasks (id >= 0)
+// and groups (~node). A group is queued in its parent while something below
+// it is queued; the groups above the running task are taken out instead
+// ("current") and put back with their new vruntime when it stops.
+struct GroupQueue {
+    std::vector<ReadyEntry> heap;
+    SimTime vruntime = 0;               // Of this group within its parent
+    SimTime minVruntime = 0;            // Clock of the children
+    long long seq = 0;
+    int currentChild = -1;              // Next group down the running path
+    bool queued = false;
+    bool current = false;
+};
+
+// Ready queue: arrival order for FIFO and RR, a binary min-heap on
+// (key, seq) for SJF, SRTF, CFS and EDF, and for RM one FIFO per fixed
+// priority level, found through a two-level bitmap of non-empty levels.
+// Grouped CFS keeps one heap per group node and picks by walking down from
+// the root, O(depth x log fan-out).
+struct ReadyQueue {
+    bool fifo = true;
+    std::deque<int> order;
+    std::vector<ReadyEntry> heap;
+    std::vector<std::deque<ReadyEntry>> levels;
+    std::vector<unsigned long long> levelBits;     // Bit l set when level l is non-empty
+    std::vector<unsigned long long> levelWords;    // Bit w set when levelBits[w] is non-zero
+    size_t levelCount = 0;
+    const GroupTree* tree = nullptr;
+    std::vector<GroupQueue> groups;
+    size_t groupCount = 0;
+    long long groupSeq = 0;
+
+    // Switch to fixed priorities 0 (first to run) .. n - 1; the key is the level
+    void useLevels(int n);
+    // Switch to hierarchical CFS over `tree`; the key is the task's vruntime
+    void useGroups(const GroupTree* groupTree);
+    bool empty() const { return size() == 0; }
+    size_t size() const {
+        return fifo ? order.size() : !levels.empty() ? levelCount : tree ? groupCount : heap.size();
+    }
+    void push(int id, SimTime key, long long seq);
+    int pop();
+    SimTime topKey() const;
+    // Remove the entry that would run last (tail of the queue, last heap leaf,
+    // or tail of the lowest level)
+    int steal();
+    // Grouped CFS: put the groups above a task that ran back in their
+    // parents, charged for `ran`
+    void chargeGroups(int id, SimTime ran);
+
+private:
+    int firstLevel() const;
+    void markLevel(int level, bool nonEmpty);
+    void queueGroup(int group);
+};
+
+enum DecisionKind {
+    DECISION_RUN,               // Process got the CPU
+    DECISION_PREEMPT,           // Process went back to the ready queue
+    DECISION_BLOCK,             // Process started an I/O burst
+    DECISION_EXIT               // Process finished its last CPU burst
+};
+
+struct Decision {
+    SimTime time;
+    long long process;
+    DecisionKind kind;
+};
+
+// One schedule entry: process ran on a CPU from start to end
+struct Segment {
+    SimTime start;
+    SimTime end;
+    int process;
+    int burst;                  // Index of the CPU burst that ran
+    int thread = -1;            // Thread of a multi-threaded process, else -1
+};
+
+// Statistics an adaptive rule can test, over the sliding window
+enum AdaptiveMetric {
+    ADAPT_ALWAYS,               // No condition
+    ADAPT_DEPTH,                // Mean ready-queue length at the last dispatches
+    ADAPT_VARIATION,            // Coefficient of variation of the last burst lengths
+    ADAPT_SHORT                 // Share of the last bursts no longer than the quantum
+};
+
+// "SRTF:cv>=1": run `policy` while `metric op threshold` holds
+struct AdaptiveRule {
+    Policy policy;
+    AdaptiveMetric metric = ADAPT_ALWAYS;
+    std::string op;             // <, <=, > or >=
+    double threshold = 0;
+};
+
+// The first matching rule picks the discipline; rules are re-evaluated
+// every `window` dispatches
+struct AdaptiveConfig {
+    std::vector<AdaptiveRule> rules;
+    int window = 32;
+};
+
+// Parse comma-separated rules such as "FIFO:depth<2,SRTF:cv>=1,RR". The
+// disciplines may be FIFO, SJF, SRTF or RR; metrics are depth, cv and short.
+bool parseAdaptiveRules(const std::string& text, AdaptiveConfig& config);
+const AdaptiveConfig& defaultAdaptiveConfig();
+
+// Sliding-window statistics of an adaptive CPU, updated in O(1) per event
+struct AdaptiveWindow {
+    std::vector<int> depths;            // Ring buffers of the last `window` samples
+    std::vector<SimTime> bursts;
+    size_t nextDepth = 0;
+    size_t nextBurst = 0;
+    size_t depthCount = 0;
+    size_t burstCount = 0;
+    long long depthSum = 0;
+    SimTime burstSum = 0;
+    double burstSquares = 0;
+    int shortBursts = 0;
+    long long dispatches = 0;
+};
+
+struct PolicySwitch {
+    SimTime time;
+    int cpu;
+    Policy from;
+    Policy to;
+    double depth;               // Window statistics that triggered the switch
+    double variation;
+    double shortShare;
+};
+
+enum IoScheduler { IO_FIFO, IO_SHORTEST, IO_DEADLINE };
+
+struct DeviceConfig {
+    int channels = 1;               // Requests served at once
+    IoScheduler scheduler = IO_FIFO;
+    SimTime expire = 100;           // IO_DEADLINE: requests waiting this long are served oldest first
+};
+
+// Parse "CHANNELS[:FIFO|SSTF|DEADLINE[:EXPIRE]],..." with one entry per device
+bool parseDevices(const std::string& text, std::vector<DeviceConfig>& devices);
+
+struct IoRequest {
+    SimTime issued;
+    SimTime service;                // The I/O burst
+    SimTime release;                // Earliest wake, for periodic processes
+    int id;
+    int cpu;
+    int device;
+};
+
+// An I/O device with a queue in front of its channels. IO_FIFO serves
+// requests in submission order, IO_SHORTEST the shortest service first (an
+// SSTF stand-in, as bursts carry no block addresses), and IO_DEADLINE the
+// shortest first unless the oldest request has waited `expire`.
+struct IoDevice {
+    struct Service {
+        SimTime end;
+        IoRequest request;
+    };
+
+    DeviceConfig config;
+    std::map<long long, IoRequest> queue;               // Waiting, by submission order
+    std::set<std::pair<SimTime, long long>> byService;  // (service, submission) of the waiting
+    std::vector<Service> serving;                       // Min-heap on end
+    std::vector<Service> started;       // Started since the owner last drained it
+    long long nextSeq = 0;
+    SimTime busy = 0;                   // Channel time spent serving
+    std::vector<SimTime> waits;         // Queueing delay of every request, in start order
+
+    void submit(const IoRequest& request, SimTime now);
+    SimTime nextCompletion() const;
+    // Free the channels of requests ending at or before t, starting waiting
+    // requests in their place at the moment each channel frees
+    void complete(SimTime t);
+
+private:
+    void start(const IoRequest& request, SimTime now);
+};
+
+// Engine tasks for the threads of every process: the threads of process i
+// are tasks first[i] .. first[i + 1] - 1
+struct ThreadLayout {
+    std::vector<ProcessSpec> tasks;
+    std::vector<int> first;
+    std::vector<int> owner;             // Process of every task
+};
+
+ThreadLayout layoutThreads(Span<ProcessSpec> processes);
+// Whether any process has more than one thread
+bool hasThreads(Span<ProcessSpec> processes);
+
+// Extra CPU time charged when a task is dispatched, before it does any work
+struct SwitchCosts {
+    SimTime contextSwitch = 0;  // Dispatching a task other than the last one on this CPU
+    SimTime migration = 0;      // First run after being moved to another CPU
+    SimTime cacheCold = 0;      // First run after I/O
+
+    bool any() const { return contextSwitch > 0 || migration > 0 || cacheCold > 0; }
+};
+
+// A task in I/O. Wakes at the same time go in the order the tasks blocked,
+// so the outcome does not depend on how tasks are numbered.
+struct IoWake {
+    SimTime time;
+    long long seq;
+    int id;
+};
+
+// Ready queue of a CPU kept by a policy plugin. The engine tracks which
+// tasks are in it, for load balancing, and collects the tasks that become
+// runnable at one instant into one call per hook.
+struct PluginQueue {
+    const sched_plugin* api = nullptr;
+    void* state = nullptr;
+    std::vector<int> members;           // Queued tasks in enqueue order, -1 where one left
+    size_t head = 0;                    // First entry of members still queued
+    size_t count = 0;                   // Queued tasks
+    std::vector<int> position;          // Index into members by task, -1 when not queued
+    std::vector<sched_task> enqueued;   // Not yet handed to the plugin
+    std::vector<sched_task> woken;
+    long long calls = 0;
+};
+
+// A simulated CPU with its own run queue. Each CPU only touches the tasks
+// that are queued, running or in I/O on it, so CPUs can be advanced
+// independently between load-balancing points.
+struct Cpu {
+    Policy policy = POLICY_FIFO;
+    SimTime quantum = 1;
+    bool recordSchedule = true;
+    const ProcessSpec* processes = nullptr;
+    std::vector<Task>* tasks = nullptr;
+
+    SimTime now = 0;
+    int running = -1;
+    SimTime runStart = 0;
+    SimTime runEnd = 0;
+    SimTime minVruntime = 0;
+    long long nextSeq = 0;
+    SwitchCosts costs;
+    int lastRun = -1;                   // Task that ran last, for context-switch costs
+    SimTime overheadEnd = 0;            // End of the switch overhead of the running task
+    int index = 0;
+    // I/O of processes with a device goes to the shared devices: at once
+    // when this CPU is alone, else through `outbox` at the next balancing point
+    std::vector<IoDevice>* devices = nullptr;
+    bool batchIo = false;
+    std::vector<IoRequest> outbox;
+
+    ReadyQueue ready;
+    std::vector<int> arrivals;          // Processes placed on this CPU, in arrival order
+    size_t nextArrival = 0;
+    std::vector<IoWake> io;             // Min-heap of (I/O completion, seq)
+    long long nextIoSeq = 0;
+
+    SimTime busy = 0;
+    int completed = 0;
+    long long migrations = 0;
+    long long contextSwitches = 0;
+    SimTime overhead = 0;               // Busy time spent on switch costs
+    std::vector<Segment> schedule;
+    std::vector<SimTime> lateness;      // Completion minus deadline of every job that had one
+    std::vector<Decision>* decisions = nullptr;   // Optional log of every scheduling decision
+
+    // Adaptive CPUs switch `policy` between disciplines at run time
+    const AdaptiveConfig* adaptive = nullptr;
+    AdaptiveWindow window;
+    std::vector<PolicySwitch> switches;
+
+    // POLICY_PLUGIN keeps its ready queue in the plugin instead of `ready`
+    PluginQueue plugin;
+
+    // Per-window telemetry, when series.width > 0
+    WindowSeries series;
+    int blocked = 0;                    // Tasks that started I/O and are not ready again
+
+    size_t queued() const { return plugin.api ? plugin.count : ready.size(); }
+    bool idle() const { return running < 0 && queued() == 0; }
+    int load() const { return (int)queued() + (running >= 0) + (int)(arrivals.size() - nextArrival); }
+    SimTime nextEvent() const;
+    // Process every event strictly before `until`
+    void advance(SimTime until);
+    void enqueue(int id, bool keepSeq);
+    // Remove the queued task that would run last, for another CPU; with a
+    // plugin, the most recently queued one
+    int steal();
+    // Hand the batched tasks to the plugin; true if it asked to preempt
+    bool flushPlugin();
+    // Lowest vruntime a CFS task may enter the queue with
+    SimTime vruntimeFloor(int id) const;
+    // Ready-queue key of a task; lower runs first
+    SimTime readyKey(const Task& task) const;
+    void dispatch();
+    void endSlice();
+    void preempt();
+    // Start adapting by `config`; the ready queue becomes a heap for every discipline
+    void useAdaptive(const AdaptiveConfig* config);
+    void observeBurst(SimTime length);
+    // Re-key the ready queue in place for another discipline, O(N)
+    void switchPolicy(Policy next);
+    // Wake a task when its device request ends, but not before `earliest`
+    void wakeAfterIo(const IoDevice::Service& service, SimTime earliest);
+    void logDecision(int id, DecisionKind kind) {
+        if (decisions) {
+            decisions->push_back({now, id, kind});
+        }
+    }
+};
+
+struct MultiCpuConfig {
+    int cpus = 1;
+    int threads = 1;
+    // Load-balancing period, the lookahead of each window; 0 balances
+    // wherever a CPU may interact with another (see runCpus)
+    SimTime balanceInterval = 0;
+    bool recordSchedule = true;
+    SimTime checkpointInterval = 0; // Spacing of checkpoints, when they are requested
+    size_t checkpointBytes = 256 << 20; // Above this, every other checkpoint is dropped
+    AdaptiveConfig adaptive;        // Rules for POLICY_ADAPTIVE; empty for the defaults
+    SwitchCosts costs;
+    std::vector<DeviceConfig> devices;  // Shared I/O devices; empty for unbounded I/O
+    bool gang = false;              // Gang-schedule the threads of each process (see gang.h)
+    const sched_plugin* plugin = nullptr;   // Hooks of POLICY_PLUGIN
+    SimTime telemetryWindow = 0;    // Width of the telemetry windows; 0 for none
+};
+
+// Snapshot of one CPU at a balancing point. Arrivals are always consumed
+// there, so only the queues and counters are kept.
+struct CpuCheckpoint {
+    SimTime now;
+    int running;
+    SimTime runStart;
+    SimTime runEnd;
+    SimTime minVruntime;
+    long long nextSeq;
+    int lastRun;
+    SimTime overheadEnd;
+    ReadyQueue ready;
+    std::vector<IoWake> io;
+    long long nextIoSeq;
+    SimTime busy;
+    int completed;
+    long long migrations;
+    long long contextSwitches;
+    SimTime overhead;
+    size_t scheduleSize;                // Segments recorded so far
+    size_t latenessSize;                // Jobs with a deadline finished so far
+    Policy policy;
+    AdaptiveWindow window;
+    size_t switchesSize;
+};
+
+// Engine state after every event before `time`. Only the tasks still in the
+// system are stored: a process that arrived earlier and is not active has
+// completed, and one that arrives later is untouched.
+struct EngineCheckpoint {
+    SimTime time;
+    std::vector<CpuCheckpoint> cpus;
+    std::vector<IoDevice> devices;      // Without their waits
+    std::vector<size_t> waitsSize;
+    std::vector<std::pair<int, Task>> active;
+};
+
+struct MultiCpuResult {
+    std::vector<SimTime> completion;    // Completion time of every process
+    SimTime makespan = 0;
+    long long migrations = 0;
+    long long contextSwitches = 0;
+    SimTime overhead = 0;               // Busy time spent on switch costs, all CPUs
+    std::vector<SimTime> busy;
+    std::vector<std::vector<Segment>> schedule;
+    std::vector<std::vector<SimTime>> lateness;     // Per CPU, in job completion order
+    std::vector<PolicySwitch> switches;             // CPU by CPU, in time order
+    std::vector<SimTime> deviceBusy;                // Channel time of every device
+    std::vector<std::vector<SimTime>> deviceWaits;  // Per device, in start order
+    // Gang scheduling only: CPU time inside slots that no gang held, and
+    // time a gang held a CPU whose thread was blocked or done
+    SimTime slotTime = 0;                           // Time covered by slots, per CPU
+    SimTime unallocated = 0;
+    SimTime stalled = 0;
+    int rows = 0;                                   // Rows of the slot matrix at its largest
+    long long pluginCalls = 0;                      // POLICY_PLUGIN: calls into the plugin, all CPUs
+    WindowSeries telemetry;                         // All CPUs, when telemetryWindow > 0
+};
+
+// Simulate `config.cpus` CPUs with per-CPU run queues. Every thread of a
+// process is a task of its own, placed and stolen freely; a process
+// completes with its last thread. CPUs are partitioned
+// over `config.threads` host threads and synchronise at balancing points,
+// when idle CPUs steal work and new arrivals are placed: every balance
+// interval, or with interval 0 wherever a CPU may interact with another. The
+// result does not depend on the number of host threads.
+// With `checkpoints`, a checkpoint is appended at the first balancing point
+// of every `config.checkpointInterval`. When they outgrow
+// `config.checkpointBytes`, every other one is dropped and the interval doubles.
+// With `config.gang`, runs gangScheduling instead, which takes no checkpoints.
+MultiCpuResult multiCpuScheduling(Span<ProcessSpec> processes, Policy policy, int quantum,
+                                  const MultiCpuConfig& config,
+                                  std::vector<EngineCheckpoint>* checkpoints = nullptr);
+
+// Continue the run that took `checkpoint` and produced `prefix`, on a workload
+// that may differ from it only in processes arriving at or after the
+// checkpoint; processes in both must keep their thread counts. The result
+// equals a full run on that workload.
+MultiCpuResult resumeMultiCpuScheduling(Span<ProcessSpec> processes, Policy policy, int quantum,
+                                        const MultiCpuConfig& config, const EngineCheckpoint& checkpoint,
+                                        const MultiCpuResult& prefix);
+
+#endif // ENGINE_H
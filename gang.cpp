@@ -0,0 +1,254 @@
+#include "gang.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+using namespace std;
+
+
+SlotMatrix::SlotMatrix(int columns) : columns(columns), words((columns + 63) / 64) {}
+
+int SlotMatrix::place(int width, vector<int>& taken) {
+    taken.clear();
+    int row;
+    auto fit = byFree.lower_bound({width, -1});
+    if (fit != byFree.end()) {
+        row = fit->second;
+        byFree.erase(fit);
+    } else {
+        row = freeCount.size();
+        freeCount.push_back(columns);
+        for (int w = 0; w < words; w++) {
+            int bits = min(64, columns - w * 64);
+            freeBits.push_back(bits == 64 ? ~0ULL : (1ULL << bits) - 1);
+        }
+    }
+    unsigned long long* bits = &freeBits[(size_t)row * words];
+    for (int w = 0; (int)taken.size() < width; w++) {
+        while (bits[w] && (int)taken.size() < width) {
+            taken.push_back(w * 64 + __builtin_ctzll(bits[w]));
+            bits[w] &= bits[w] - 1;
+        }
+    }
+    freeCount[row] -= width;
+    byFree.insert({freeCount[row], row});
+    return row;
+}
+
+void SlotMatrix::release(int row, const vector<int>& taken) {
+    byFree.erase({freeCount[row], row});
+    for (int c : taken) {
+        freeBits[(size_t)row * words + c / 64] |= 1ULL << (c % 64);
+    }
+    freeCount[row] += taken.size();
+    byFree.insert({freeCount[row], row});
+}
+
+enum ThreadState { THREAD_READY, THREAD_IO, THREAD_DONE };
+
+MultiCpuResult gangScheduling(Span<ProcessSpec> processes, int quantum, const MultiCpuConfig& config) {
+    int numProcesses = processes.size();
+    int numCpus = max(1, config.cpus);
+    SimTime slice = max(1, quantum);
+    ThreadLayout layout = layoutThreads(processes);
+    int numTasks = layout.tasks.size();
+
+    vector<Task> tasks(numTasks);
+    vector<ThreadState> state(numTasks, THREAD_READY);
+    vector<int> column(numTasks);
+    vector<SimTime> runStart(numTasks);
+    for (int i = 0; i < numTasks; i++) {
+        tasks[i] = startTask(layout.tasks[i]);
+    }
+
+    SlotMatrix matrix(numCpus);
+    vector<int> gangRow(numProcesses);
+    vector<vector<int>> gangColumns(numProcesses);
+    vector<int> alive(numProcesses);        // Threads not done yet
+    vector<vector<int>> rowGangs;
+    vector<int> rowReady;                   // Ready threads of every row
+    set<int> runnable;                      // Rows with a ready thread
+    vector<pair<SimTime, int>> io;          // Min-heap of (I/O completion, thread)
+
+    vector<int> arrivalOrder(numProcesses);
+    iota(arrivalOrder.begin(), arrivalOrder.end(), 0);
+    stable_sort(arrivalOrder.begin(), arrivalOrder.end(),
+                [&](int a, int b) { return processes[a].arrival < processes[b].arrival; });
+    int nextArrival = 0;
+
+    MultiCpuResult result;
+    result.completion.resize(numProcesses);
+    result.busy.assign(numCpus, 0);
+    result.schedule.resize(numCpus);
+    result.lateness.resize(numCpus);
+
+    SimTime now = 0;
+    int done = 0;
+    int turnRow = -1;                       // Row whose turn it is, -1 between turns
+    int lastRow = -1;
+    vector<int> running;                    // Threads on a CPU in this turn
+
+    auto setReady = [&](int id) {
+        state[id] = THREAD_READY;
+        int row = gangRow[layout.owner[id]];
+        if (rowReady[row]++ == 0) {
+            runnable.insert(row);
+        }
+        if (row == turnRow) {
+            runStart[id] = now;
+            running.push_back(id);
+        }
+    };
+
+    auto admit = [&]() {
+        while (nextArrival < numProcesses && processes[arrivalOrder[nextArrival]].arrival <= now) {
+            int i = arrivalOrder[nextArrival++];
+            int row = matrix.place(processes[i].threads, gangColumns[i]);
+            if (row == (int)rowGangs.size()) {
+                rowGangs.emplace_back();
+                rowReady.push_back(0);
+            }
+            result.rows = max(result.rows, matrix.rows());
+            gangRow[i] = row;
+            rowGangs[row].push_back(i);
+            alive[i] = processes[i].threads;
+            for (int k = 0; k < processes[i].threads; k++) {
+                column[layout.first[i] + k] = gangColumns[i][k];
+                setReady(layout.first[i] + k);
+            }
+        }
+    };
+
+    auto wake = [&]() {
+        while (!io.empty() && io.front().first <= now) {
+            int id = io.front().second;
+            pop_heap(io.begin(), io.end(), greater<pair<SimTime, int>>());
+            io.pop_back();
+            setReady(id);
+        }
+    };
+
+    // Take a running thread off its CPU, charging what it ran
+    auto stop = [&](int id) {
+        Task& task = tasks[id];
+        SimTime ran = now - runStart[id];
+        task.remaining -= ran;
+        result.busy[column[id]] += ran;
+        if (ran > 0 && config.recordSchedule) {
+            int owner = layout.owner[id];
+            int thread = processes[owner].threads > 1 ? id - layout.first[owner] : -1;
+            result.schedule[column[id]].push_back({runStart[id], now, owner, task.burst, thread});
+        }
+    };
+
+    // The CPU burst of a thread is over: start its I/O, or finish it
+    auto endBurst = [&](int id) {
+        const ProcessSpec& process = layout.tasks[id];
+        Task& task = tasks[id];
+        int owner = layout.owner[id];
+        int row = gangRow[owner];
+        if (--rowReady[row] == 0) {
+            runnable.erase(row);
+        }
+        if (task.deadline != NEVER) {
+            result.lateness[column[id]].push_back(now - task.deadline);
+        }
+        task.burst++;
+        int ioBurst, cpuBurst;
+        if (task.cursor.next(process, ioBurst) && task.cursor.next(process, cpuBurst)) {
+            SimTime wake = now + ioBurst;
+            SimTime release = wake;
+            if (process.period > 0) {
+                release = process.arrival + task.burst * process.period;
+                wake = max(wake, release);
+            }
+            SimTime deadline = relativeDeadline(process);
+            task.deadline = deadline == NEVER ? NEVER : release + deadline;
+            task.remaining = cpuBurst;
+            state[id] = THREAD_IO;
+            io.push_back({wake, id});
+            push_heap(io.begin(), io.end(), greater<pair<SimTime, int>>());
+            return;
+        }
+        state[id] = THREAD_DONE;
+        task.completed = true;
+        task.completion = now;
+        if (--alive[owner] == 0) {
+            result.completion[owner] = now;
+            result.makespan = max(result.makespan, now);
+            matrix.release(row, gangColumns[owner]);
+            vector<int>& gangs = rowGangs[row];
+            gangs.erase(find(gangs.begin(), gangs.end(), owner));
+            done++;
+        }
+    };
+
+    while (done < numProcesses) {
+        admit();
+        wake();
+        if (runnable.empty()) {
+            // Every gang is blocked; skip to the next arrival or wake
+            SimTime next = io.empty() ? NEVER : io.front().first;
+            if (nextArrival < numProcesses) {
+                next = min(next, processes[arrivalOrder[nextArrival]].arrival);
+            }
+            now = next;
+            continue;
+        }
+
+        // Rows take turns in index order
+        auto next = runnable.upper_bound(lastRow);
+        turnRow = next == runnable.end() ? *runnable.begin() : *next;
+        lastRow = turnRow;
+        SimTime turnEnd = now + slice;
+        for (int gang : rowGangs[turnRow]) {
+            for (int id = layout.first[gang]; id < layout.first[gang + 1]; id++) {
+                if (state[id] == THREAD_READY) {
+                    runStart[id] = now;
+                    running.push_back(id);
+                }
+            }
+        }
+
+        while (!running.empty()) {
+            SimTime t = turnEnd;
+            for (int id : running) {
+                t = min(t, runStart[id] + tasks[id].remaining);
+            }
+            if (!io.empty()) {
+                t = min(t, io.front().first);
+            }
+            if (nextArrival < numProcesses) {
+                t = min(t, processes[arrivalOrder[nextArrival]].arrival);
+            }
+            int held = numCpus - matrix.freeColumns(turnRow);
+            result.slotTime += t - now;
+            result.unallocated += (numCpus - held) * (t - now);
+            result.stalled += (held - (int)running.size()) * (t - now);
+            now = t;
+
+            for (size_t j = 0; j < running.size();) {
+                int id = running[j];
+                if (runStart[id] + tasks[id].remaining > now) {
+                    j++;
+                    continue;
+                }
+                stop(id);
+                running[j] = running.back();
+                running.pop_back();
+                endBurst(id);
+            }
+            admit();
+            wake();
+            if (now >= turnEnd) {
+                // The turn is over; the threads stay ready for the row's next one
+                for (int id : running) {
+                    stop(id);
+                }
+                running.clear();
+            }
+        }
+        turnRow = -1;
+    }
+    return result;
+}
@@ -0,0 +1,43 @@
+#ifndef GANG_H
+#define GANG_H
+
+#include <set>
+#include <utility>
+#include <vector>
+#include "engine.h"
+
+// Ousterhout matrix: one row per time slot, one column per CPU. A gang takes
+// free columns of a single row, and the fullest row it fits in is chosen so
+// that wide gaps stay open for wide gangs. Placing a gang costs
+// O(log rows + width + columns / 64).
+class SlotMatrix {
+public:
+    explicit SlotMatrix(int columns);
+
+    // Take `width` free columns, adding a row if no row has room; returns
+    // the row, with the columns in `taken`
+    int place(int width, std::vector<int>& taken);
+    void release(int row, const std::vector<int>& taken);
+
+    int rows() const { return freeCount.size(); }
+    int freeColumns(int row) const { return freeCount[row]; }
+
+private:
+    int columns;
+    int words;                                  // Bitmap words per row
+    std::vector<unsigned long long> freeBits;   // Bit c of row r set while column c is free
+    std::vector<int> freeCount;
+    std::set<std::pair<int, int>> byFree;       // (free columns, row) of every row
+};
+
+// Gang scheduling on `config.cpus` CPUs. Every process is a gang that holds
+// one column per thread in a row of a SlotMatrix, so its threads only ever
+// run side by side. Rows take turns of up to `quantum`, skipping rows with
+// nothing ready; a turn ends early once none of its threads can run. A
+// thread that blocks or finishes leaves its CPU idle for the rest of the
+// turn ("stalled"), and columns no gang holds stay idle ("unallocated").
+// Gangs are placed in arrival order and give their columns back when their
+// last thread completes. I/O is unbounded and switch costs are not charged.
+MultiCpuResult gangScheduling(Span<ProcessSpec> processes, int quantum, const MultiCpuConfig& config);
+
+#endif // GANG_H
@@ -1,555 +1,703 @@
 #include <iostream>
 #include <fstream>
 #include <vector>
-#include <queue>
 #include <string>
 #include <sstream>
 #include <algorithm>
-#include <numeric> // For std::accumulate
-#include <climits>
-#include <deque>  // Include deque header
-#include <algorithm>  // Include for std::min
+#include <memory>
+#include <stdexcept>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "workload.h"
+#include "simulator.h"
+#include "replicas.h"
+#include "online.h"
+#include "cache.h"
+#include "whatif.h"
+#include "trace.h"
+#include "pipeline.h"
+#include "cluster.h"
+#include "plugin.h"
 using namespace std;
 
 
-struct Process {
-    int arrivalTime;
-    vector<int> cpuBursts;
-    vector<int> ioBursts;
-    int currentCpuBurst = 0;
-    int currentIoBurst = 0;
-    int completionTime = 0;
-    int remainingTime=0;
-    int totalCpuBurstTime=0;
-    int turnaroundTime = 0;
-    int waitingTime = 0;
-    bool inIO = false;
-    bool completed = false;
-    int ioCompletionTime = 0;
-    int remainingCpuBurst = 0; // For SJF and SRTF
-    int startTime = 0; // For CFS
-};
-
-
-// Read workload file
-vector<Process> readWorkloadFile(const string& filePath) {
-    ifstream infile(filePath);
-    vector<Process> processes;
-    string line;
+// Prints the schedule, the per-process table and the averages
+class PrintingSink : public MetricsSink {
+public:
+    // A non-empty `telemetryPath` receives the telemetry windows, in binary
+    // when it ends in .bin and as CSV otherwise
+    explicit PrintingSink(bool multiCpu, const string& telemetryPath = "")
+        : multiCpu(multiCpu), telemetryPath(telemetryPath) {}
 
-    while (getline(infile, line)) {
-        Process p;
-        istringstream iss(line);
-        int value;
-
-        iss >> p.arrivalTime;
-
-        bool isCpuBurst = true;
-        while (iss >> value && value != -1) {
-            if (isCpuBurst) {
-                p.cpuBursts.push_back(value);
-            } else {
-                p.ioBursts.push_back(value);
-            }
-            isCpuBurst = !isCpuBurst;
+    void onSegment(int cpu, const Segment& segment) override {
+        if (multiCpu) {
+            cout << "CPU " << cpu + 1 << ": ";
+        } else if (segment.start > lastEnd) {
+            cout << "No process ready at time " << segment.start << ". Advancing time." << endl;
         }
-
-        // Initialize remaining CPU burst for SJF and SRTF
-        p.remainingCpuBurst = accumulate(p.cpuBursts.begin(), p.cpuBursts.end(), 0);
-        
-        processes.push_back(p);
+        cout << "Executing Process " << segment.process + 1;
+        if (segment.thread >= 0) {
+            cout << " Thread " << segment.thread + 1;
+        }
+        cout << ", CPU Burst " << segment.burst + 1
+             << " from " << segment.start << " to " << segment.end << "\n";
+        lastEnd = segment.end;
     }
 
-    return processes;
-}
-
-// FIFO Scheduling
-void fifoScheduling(vector<Process>& processes) {
-    int currentTime = 0;
-    vector<int> readyQueue;
-    int numProcesses = processes.size();
-    int processesCompleted = 0;
-
-    while (processesCompleted < numProcesses) {
-        // Add new arrivals to the ready queue
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].arrivalTime <= currentTime && !processes[i].inIO && !processes[i].completed) {
-                if (find(readyQueue.begin(), readyQueue.end(), i) == readyQueue.end()) {
-                    readyQueue.push_back(i);
-                }
-            }
+    void onProcess(const ProcessMetrics& process) override {
+        if (process.process == 0) {
+            cout << "\nProcess\tArrival Time\tTotalCpuBurst\tCompletion Time\tTAT\tWT\n";
         }
+        cout << "P" << process.process + 1 << "\t"
+             << process.arrival << "\t\t"
+             << process.totalCpuBurst << "\t\t"
+             << process.completion << "\t\t"
+             << process.turnaround << "\t"
+             << process.waiting << "\n";
+    }
 
-        // Check if any process has completed its I/O and is ready for the next CPU burst
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].inIO && processes[i].ioCompletionTime <= currentTime) {
-                readyQueue.push_back(i);
-                processes[i].inIO = false;
+    void onSummary(const RunSummary& summary) override {
+        cout << "\nAverage Turnaround Time (ATAT): " << summary.averageTurnaround << endl;
+        cout << "Average Waiting Time (AWT): " << summary.averageWaiting << endl;
+        cout << "Makespan: " << summary.makespan << endl;
+        if (multiCpu) {
+            cout << "Migrations: " << summary.migrations << endl;
+            for (size_t c = 0; c < summary.busy.size(); c++) {
+                double utilisation = summary.makespan > 0 ? 100.0 * summary.busy[c] / summary.makespan : 0.0;
+                cout << "CPU " << c + 1 << " utilisation: " << utilisation << "%" << endl;
             }
         }
-
-        if (!readyQueue.empty()) {
-            int processID = readyQueue.front();
-            readyQueue.erase(readyQueue.begin());
-
-            Process& process = processes[processID];
-            cout << "Executing Process " << processID + 1 << ", CPU Burst " << process.currentCpuBurst + 1 << endl;
-            currentTime += process.cpuBursts[process.currentCpuBurst];
-            process.currentCpuBurst++;
-
-            if (process.currentCpuBurst < process.cpuBursts.size()) {
-                process.inIO = true;
-                process.ioCompletionTime = currentTime + process.ioBursts[process.currentIoBurst++];
-            } else {
-                process.completionTime = currentTime;
-                process.completed = true;
-                processesCompleted++;
+        if (summary.overhead > 0) {
+            SimTime busy = 0;
+            for (SimTime cpuBusy : summary.busy) {
+                busy += cpuBusy;
             }
-        } else {
-            int nextEventTime = INT_MAX;
-            for (int i = 0; i < numProcesses; i++) {
-                if (!processes[i].completed) {
-                    if (processes[i].arrivalTime > currentTime) {
-                        nextEventTime = min(nextEventTime, processes[i].arrivalTime);
-                    }
-                    if (processes[i].inIO) {
-                        nextEventTime = min(nextEventTime, processes[i].ioCompletionTime);
-                    }
-                }
+            cout << "Context switches: " << summary.contextSwitches << endl;
+            cout << "Switch overhead: " << summary.overhead << " ("
+                 << (busy > 0 ? 100.0 * summary.overhead / busy : 0.0) << "% of busy time)" << endl;
+        }
+        if (summary.deadlineJobs > 0) {
+            SimTime busy = 0;
+            for (SimTime cpuBusy : summary.busy) {
+                busy += cpuBusy;
             }
-
-            if (nextEventTime != INT_MAX) {
-                currentTime = nextEventTime;
-                cout << "No process ready at time " << currentTime << ". Advancing time." << endl;
+            double capacity = (double)summary.makespan * summary.busy.size();
+            cout << "Deadline misses: " << summary.missedDeadlines << " of " << summary.deadlineJobs << " jobs ("
+                 << 100.0 * summary.missedDeadlines / summary.deadlineJobs << "%)" << endl;
+            cout << "Lateness p50/p90/p99/max: " << summary.latenessP50 << "/" << summary.latenessP90 << "/"
+                 << summary.latenessP99 << "/" << summary.latenessMax << endl;
+            cout << "Utilisation: " << (capacity > 0 ? 100.0 * busy / capacity : 0.0) << "% (periodic demand "
+                 << 100.0 * summary.periodicDemand << "%)" << endl;
+        }
+        if (summary.slotTime > 0) {
+            SimTime idle = summary.makespan * (SimTime)summary.busy.size();
+            for (SimTime cpuBusy : summary.busy) {
+                idle -= cpuBusy;
             }
+            double slotCapacity = (double)summary.slotTime * summary.busy.size();
+            cout << "Idle CPU time: " << idle << endl;
+            cout << "Gang slot time: " << summary.slotTime << " (" << summary.gangRows << " matrix rows)" << endl;
+            cout << "Fragmentation: " << summary.unallocated << " CPU time unallocated ("
+                 << 100.0 * summary.unallocated / slotCapacity << "% of slot time)" << endl;
+            cout << "Gang stalls: " << summary.stalled << " CPU time held by blocked or finished threads ("
+                 << 100.0 * summary.stalled / slotCapacity << "% of slot time)" << endl;
         }
-    }
-
-    for (auto& process : processes) {
-        process.totalCpuBurstTime = accumulate(process.cpuBursts.begin(), process.cpuBursts.end(), 0);
-        process.turnaroundTime = process.completionTime - process.arrivalTime;
-        process.waitingTime = process.turnaroundTime - process.totalCpuBurstTime;
-    }
-}
-
-// Shortest Job First (SJF)
-void sjfScheduling(vector<Process>& processes) {
-    int currentTime = 0;
-    vector<int> readyQueue;
-    vector<int> completedProcesses;
-    int numProcesses = processes.size();
-    int processesCompleted = 0;
-
-    while (processesCompleted < numProcesses) {
-        // Add new arrivals to the ready queue
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].arrivalTime <= currentTime && !processes[i].inIO && !processes[i].completed) {
-                if (find(readyQueue.begin(), readyQueue.end(), i) == readyQueue.end()) {
-                    readyQueue.push_back(i);
-                }
+        if (!summary.groups.empty()) {
+            SimTime total = summary.groups[0].cpuTime;
+            cout << "\nGroup\tProcesses\tCPU share\tATAT\tAWT\tp95 TAT\tp99 TAT\tmax WT\n";
+            for (const GroupMetrics& group : summary.groups) {
+                cout << group.path << "\t" << group.processes << "\t\t"
+                     << (total > 0 ? 100.0 * group.cpuTime / total : 0.0) << "%\t\t"
+                     << group.averageTurnaround << "\t" << group.averageWaiting << "\t"
+                     << group.p95Turnaround << "\t" << group.p99Turnaround << "\t" << group.maxWaiting << "\n";
             }
         }
-
-        // Check if any process has completed its I/O and is ready for the next CPU burst
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].inIO && processes[i].ioCompletionTime <= currentTime) {
-                readyQueue.push_back(i);
-                processes[i].inIO = false;
+        if (!summary.devices.empty()) {
+            cout << "\nDevice\tChannels\tRequests\tUtilisation\tMean wait\tp50/p90/p99/max wait\n";
+            for (size_t d = 0; d < summary.devices.size(); d++) {
+                const DeviceMetrics& device = summary.devices[d];
+                cout << d << "\t" << device.channels << "\t\t" << device.requests << "\t\t"
+                     << 100.0 * device.utilisation << "%\t\t" << device.meanWait << "\t\t" << device.waitP50 << "/"
+                     << device.waitP90 << "/" << device.waitP99 << "/" << device.waitMax << "\n";
             }
         }
-
-        if (!readyQueue.empty()) {
-            // Find the process with the shortest CPU burst
-            int shortestJobID = readyQueue[0];
-            for (int id : readyQueue) {
-                if (processes[id].cpuBursts[processes[id].currentCpuBurst] < processes[shortestJobID].cpuBursts[processes[shortestJobID].currentCpuBurst]) {
-                    shortestJobID = id;
-                }
+        if (!summary.switches.empty()) {
+            cout << "\nPolicy switches: " << summary.switches.size() << "\n";
+            cout << "Time\tCPU\tSwitch\t\tDepth\tCV\tShort\n";
+            for (const PolicySwitch& change : summary.switches) {
+                cout << change.time << "\t" << change.cpu + 1 << "\t" << policyName(change.from) << " -> "
+                     << policyName(change.to) << "\t" << change.depth << "\t" << change.variation << "\t"
+                     << change.shortShare << "\n";
             }
-
-            readyQueue.erase(remove(readyQueue.begin(), readyQueue.end(), shortestJobID), readyQueue.end());
-
-            Process& process = processes[shortestJobID];
-            cout << "Executing Process " << shortestJobID + 1 << ", CPU Burst " << process.currentCpuBurst + 1 << endl;
-            currentTime += process.cpuBursts[process.currentCpuBurst];
-            process.currentCpuBurst++;
-
-            if (process.currentCpuBurst < process.cpuBursts.size()) {
-                process.inIO = true;
-                process.ioCompletionTime = currentTime + process.ioBursts[process.currentIoBurst++];
+        }
+        if (!summary.telemetry.empty() && !telemetryPath.empty()) {
+            bool binary = telemetryPath.size() > 4 && telemetryPath.compare(telemetryPath.size() - 4, 4, ".bin") == 0;
+            ofstream out(telemetryPath, binary ? ios::binary | ios::trunc : ios::trunc);
+            if (binary) {
+                writeTelemetryBinary(out, summary.telemetryWindow, summary.telemetry);
             } else {
-                process.completionTime = currentTime;
-                process.completed = true;
-                processesCompleted++;
+                writeTelemetryCsv(out, summary.telemetry);
             }
-        } else {
-            int nextEventTime = INT_MAX;
-            for (int i = 0; i < numProcesses; i++) {
-                if (!processes[i].completed) {
-                    if (processes[i].arrivalTime > currentTime) {
-                        nextEventTime = min(nextEventTime, processes[i].arrivalTime);
-                    }
-                    if (processes[i].inIO) {
-                        nextEventTime = min(nextEventTime, processes[i].ioCompletionTime);
-                    }
-                }
-            }
-
-            if (nextEventTime != INT_MAX) {
-                currentTime = nextEventTime;
-                cout << "No process ready at time " << currentTime << ". Advancing time." << endl;
+            if (out) {
+                cout << "\nTelemetry: " << summary.telemetry.size() << " windows of " << summary.telemetryWindow
+                     << " written to " << telemetryPath << endl;
+            } else {
+                cerr << "Cannot write telemetry to " << telemetryPath << endl;
             }
         }
     }
 
-    for (auto& process : processes) {
-        process.totalCpuBurstTime = accumulate(process.cpuBursts.begin(), process.cpuBursts.end(), 0);
-        process.turnaroundTime = process.completionTime - process.arrivalTime;
-        process.waitingTime = process.turnaroundTime - process.totalCpuBurstTime;
+private:
+    bool multiCpu;
+    string telemetryPath;
+    SimTime lastEnd = 0;
+};
+
+// Print mean and 95% confidence interval of ATAT and AWT for every policy
+void printReplicaSummaries(const vector<ReplicaSummary>& summaries, const ReplicaConfig& config) {
+    cout << "Replicas: " << config.replicas << " ("
+         << (config.distribution == JITTER_NORMAL ? "normal" : "uniform") << " jitter " << config.scale
+         << ", seed " << config.seed << ")" << endl;
+    // Switch columns only when switches cost anything
+    bool costs = config.engine.costs.any();
+    cout << "\nPolicy\tATAT\t95% CI\t\tAWT\t95% CI" << (costs ? "\t\tSwitches\tOverhead" : "") << "\n";
+    for (const ReplicaSummary& summary : summaries) {
+        cout << policyName(summary.policy) << "\t"
+             << summary.meanTAT << "\t+/- " << summary.halfWidthTAT << "\t"
+             << summary.meanWT << "\t+/- " << summary.halfWidthWT;
+        if (costs) {
+            cout << "\t" << summary.meanSwitches << "\t\t" << summary.meanOverhead;
+        }
+        cout << "\n";
     }
 }
 
-// Shortest Remaining Time First (SRTF)
-void srtfScheduling(vector<Process>& processes) {
-    int currentTime = 0;
-    vector<int> readyQueue;
-    int numProcesses = processes.size();
-    vector<int> remainingTime(numProcesses, 0);
-    int processesCompleted = 0;
+void printClusterSummary(const ClusterSummary& summary, const PolicyConfig& config, const ClusterConfig& cluster) {
+    cout << "Cluster: " << cluster.servers << " " << policyName(config.policy) << " servers, "
+         << dispatchName(cluster) << " dispatch" << endl;
+    cout << "Jobs: " << summary.jobs << endl;
+    cout << "Average Turnaround Time (ATAT): " << summary.averageTurnaround << endl;
+    cout << "Average Waiting Time (AWT): " << summary.averageWaiting << endl;
+    cout << "Turnaround p50/p99/max: " << summary.p50Turnaround << "/" << summary.p99Turnaround << "/"
+         << summary.maxTurnaround << endl;
+    cout << "Max Waiting Time: " << summary.maxWaiting << endl;
+    cout << "Makespan: " << summary.makespan << endl;
+    cout << "Server utilisation: mean " << 100.0 * summary.meanUtilisation << "%, min "
+         << 100.0 * summary.minUtilisation << "%, max " << 100.0 * summary.maxUtilisation << "%" << endl;
+    cout << "Peak jobs on a server: " << summary.peakJobs << endl;
+    if (summary.missedDeadlines > 0) {
+        cout << "Missed deadlines: " << summary.missedDeadlines << endl;
+    }
+    if (summary.overhead > 0) {
+        cout << "Switch overhead: " << summary.overhead << endl;
+    }
+    if (summary.policySwitches > 0) {
+        cout << "Policy switches: " << summary.policySwitches << endl;
+    }
+    if (summary.late > 0) {
+        cerr << summary.late << " processes arrived out of order and were dispatched late" << endl;
+    }
+}
 
-    // Initialize remaining times for the current burst
-    for (int i = 0; i < numProcesses; i++) {
-        if (!processes[i].cpuBursts.empty()) {
-            remainingTime[i] = processes[i].cpuBursts[processes[i].currentCpuBurst];
+// Print the run times of every policy against the fastest built-in one
+void printPolicyTimings(const vector<PolicyTiming>& timings, const PolicyPlugin* plugin) {
+    double fastest = 0;
+    for (const PolicyTiming& timing : timings) {
+        if (timing.policy != POLICY_PLUGIN && (fastest == 0 || timing.meanMillis < fastest)) {
+            fastest = timing.meanMillis;
         }
     }
-
-    while (processesCompleted < numProcesses) {
-        // Add new arrivals to the ready queue
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].arrivalTime <= currentTime && !processes[i].inIO && !processes[i].completed) {
-                if (find(readyQueue.begin(), readyQueue.end(), i) == readyQueue.end()) {
-                    readyQueue.push_back(i);
-                }
-            }
+    cout << "Timing: " << timings[0].runs << " runs per policy" << endl;
+    cout << "\nPolicy\tMean ms\tMin ms\tSwitches\tPlugin calls" << (fastest > 0 ? "\tvs fastest built-in" : "") << "\n";
+    for (const PolicyTiming& timing : timings) {
+        cout << (timing.policy == POLICY_PLUGIN ? plugin->name() : policyName(timing.policy)) << "\t"
+             << timing.meanMillis << "\t" << timing.minMillis << "\t" << timing.contextSwitches << "\t\t"
+             << timing.pluginCalls;
+        if (fastest > 0) {
+            cout << "\t\t" << timing.meanMillis / fastest << "x";
         }
+        cout << "\n";
+    }
+}
 
-        // Check if any process has completed its I/O and is ready for the next CPU burst
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].inIO && processes[i].ioCompletionTime <= currentTime) {
-                processes[i].inIO = false;
-                if (find(readyQueue.begin(), readyQueue.end(), i) == readyQueue.end()) {
-                    readyQueue.push_back(i);
-                }
-                // Update remaining time for the next CPU burst
-                if (processes[i].currentCpuBurst < processes[i].cpuBursts.size()) {
-                    remainingTime[i] = processes[i].cpuBursts[processes[i].currentCpuBurst];
-                }
-            }
+// Read a what-if diff: "<process> <workload line>" per line, where the
+// process number is 1-based and one past the last process appends
+bool readWorkloadChanges(const string& path, vector<pair<size_t, Process>>& changes) {
+    ifstream in(path);
+    if (!in) {
+        return false;
+    }
+    string line;
+    Process p;
+    while (getline(in, line)) {
+        istringstream iss(line);
+        size_t process;
+        if (!(iss >> process)) {
+            continue;  // Blank line
         }
-
-        if (!readyQueue.empty()) {
-            // Find the process with the shortest remaining current CPU burst time
-            int shortestTimeID = readyQueue[0];
-            for (int id : readyQueue) {
-                if (remainingTime[id] < remainingTime[shortestTimeID]) {
-                    shortestTimeID = id;
-                }
-            }
-
-            Process& process = processes[shortestTimeID];
-            int timeSlice = min(remainingTime[shortestTimeID], 1); // Time slice of 1 for simplicity
-
-            cout << "Executing Process " << shortestTimeID + 1 << ", CPU Burst " << process.currentCpuBurst + 1 << " for " << timeSlice << " units\n";
-            currentTime += timeSlice;
-            remainingTime[shortestTimeID] -= timeSlice;
-
-            if (remainingTime[shortestTimeID] <= 0) {
-                process.currentCpuBurst++;
-                if (process.currentCpuBurst < process.cpuBursts.size()) {
-                    // Process goes to I/O
-                    process.inIO = true;
-                    process.ioCompletionTime = currentTime + process.ioBursts[process.currentIoBurst++];
-                    // Remove from ready queue
-                    readyQueue.erase(remove(readyQueue.begin(), readyQueue.end(), shortestTimeID), readyQueue.end());
-                } else {
-                    // Process is completed
-                    process.completionTime = currentTime;
-                    process.completed = true;
-                    processesCompleted++;
-                    readyQueue.erase(remove(readyQueue.begin(), readyQueue.end(), shortestTimeID), readyQueue.end());
-                }
-            }
-        } else {
-            // Advance time to the next event
-            int nextEventTime = INT_MAX;
-            for (int i = 0; i < numProcesses; i++) {
-                if (!processes[i].completed) {
-                    if (processes[i].arrivalTime > currentTime) {
-                        nextEventTime = min(nextEventTime, processes[i].arrivalTime);
-                    }
-                    if (processes[i].inIO) {
-                        nextEventTime = min(nextEventTime, processes[i].ioCompletionTime);
-                    }
-                }
-            }
-
-
-            if (nextEventTime != INT_MAX) {
-                currentTime = nextEventTime;
-                cout << "No process ready at time " << currentTime << ". Advancing time." << endl;
-            }
+        string rest;
+        getline(iss, rest);
+        if (process == 0 || !parseWorkloadLine(rest, p)) {
+            return false;
         }
+        changes.push_back({process - 1, p});
     }
+    return true;
+}
 
-    // Compute turnaround and waiting times
-    for (auto& process : processes) {
-        process.totalCpuBurstTime = accumulate(process.cpuBursts.begin(), process.cpuBursts.end(), 0);
-        process.turnaroundTime = process.completionTime - process.arrivalTime;
-        process.waitingTime = process.turnaroundTime - process.totalCpuBurstTime;
+// Convert a scheduler trace to workload lines on stdout, streaming
+bool importTrace(const string& path, const TraceConfig& config) {
+    ifstream in(path);
+    if (!in) {
+        cerr << "Cannot open trace " << path << endl;
+        return false;
+    }
+    TraceImporter importer(config);
+    vector<Process> processes;
+    auto printProcesses = [&]() {
+        importer.drainProcesses(processes);
+        for (const Process& p : processes) {
+            cout << formatWorkloadLine(p) << '\n';
+        }
+        processes.clear();
+    };
+    string line;
+    while (getline(in, line)) {
+        importer.addLine(line);
+        printProcesses();
     }
+    importer.finish();
+    printProcesses();
+    const TraceStats& stats = importer.stats();
+    cerr << "Imported " << stats.processes << " processes from " << stats.tasks << " tasks (" << stats.events
+         << " of " << stats.lines << " lines were scheduler events, " << stats.dropped << " tasks never ran)" << endl;
+    return true;
 }
 
-// Completely Fair Scheduler (CFS)
-void cfsScheduling(vector<Process>& processes) {
-    int currentTime = 0;
-    vector<int> readyQueue;
-    int numProcesses = processes.size();
-    int processesCompleted = 0;
-    const int timeSlice = 1; // CFS time slice
-
-    while (processesCompleted < numProcesses) {
-        // Add new arrivals to the ready queue
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].arrivalTime <= currentTime && !processes[i].inIO && !processes[i].completed) {
-                if (find(readyQueue.begin(), readyQueue.end(), i) == readyQueue.end()) {
-                    readyQueue.push_back(i);
-                }
+// Reads newline-terminated records from a file descriptor
+class LineReader {
+public:
+    explicit LineReader(int fd) : fd(fd) {}
+
+    // False at end of input
+    bool next(string& line) {
+        while (true) {
+            size_t end = buffer.find('\n', pos);
+            if (end != string::npos) {
+                line.assign(buffer, pos, end - pos);
+                pos = end + 1;
+                return true;
             }
-        }
-
-        // Check if any process has completed its I/O and is ready for the next CPU burst
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].inIO && processes[i].ioCompletionTime <= currentTime) {
-                readyQueue.push_back(i);
-                processes[i].inIO = false;
+            buffer.erase(0, pos);
+            pos = 0;
+            char chunk[1 << 16];
+            ssize_t n = read(fd, chunk, sizeof(chunk));
+            if (n <= 0) {
+                if (buffer.empty()) {
+                    return false;
+                }
+                line.swap(buffer);
+                buffer.clear();
+                return true;
             }
+            buffer.append(chunk, n);
         }
+    }
 
-        if (!readyQueue.empty()) {
-            int processID = readyQueue.front();
-            readyQueue.erase(readyQueue.begin());
-
-            Process& process = processes[processID];
-            int burstTime = process.cpuBursts[process.currentCpuBurst];
-            int slice = min(burstTime, timeSlice);
-
-            cout << "Executing Process " << processID + 1 << ", CPU Burst " << process.currentCpuBurst + 1 << " for " << slice << " units\n";
-            currentTime += slice;
-            process.cpuBursts[process.currentCpuBurst] -= slice;
+    // True when the next line can be returned without blocking
+    bool buffered() const { return buffer.find('\n', pos) != string::npos; }
 
-            if (process.cpuBursts[process.currentCpuBurst] == 0) {
-                process.currentCpuBurst++;
-                if (process.currentCpuBurst < process.cpuBursts.size()) {
-                    process.inIO = true;
-                    process.ioCompletionTime = currentTime + process.ioBursts[process.currentIoBurst++];
-                } else {
-                    process.completionTime = currentTime;
-                    process.completed = true;
-                    processesCompleted++;
-                }
-            } else {
-                readyQueue.push_back(processID);
-            }
-        } else {
-            int nextEventTime = INT_MAX;
-            for (int i = 0; i < numProcesses; i++) {
-                if (!processes[i].completed) {
-                    if (processes[i].arrivalTime > currentTime) {
-                        nextEventTime = min(nextEventTime, processes[i].arrivalTime);
-                    }
-                    if (processes[i].inIO) {
-                        nextEventTime = min(nextEventTime, processes[i].ioCompletionTime);
-                    }
-                }
-            }
+private:
+    int fd;
+    string buffer;
+    size_t pos = 0;
+};
 
-            if (nextEventTime != INT_MAX) {
-                currentTime = nextEventTime;
-                cout << "No process ready at time " << currentTime << ". Advancing time." << endl;
-            }
-        }
+// Listen on a Unix domain socket and wait for the generator to connect
+int acceptUnixSocket(const string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        cerr << "Socket path too long: " << path << endl;
+        return -1;
     }
+    strcpy(address.sun_path, path.c_str());
 
-    for (auto& process : processes) {
-        process.totalCpuBurstTime = accumulate(process.cpuBursts.begin(), process.cpuBursts.end(), 0);
-        process.turnaroundTime = process.completionTime - process.arrivalTime;
-        process.waitingTime = process.turnaroundTime - process.totalCpuBurstTime;
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        perror("socket");
+        return -1;
     }
+    unlink(path.c_str());
+    if (bind(listener, (sockaddr*)&address, sizeof(address)) < 0 || listen(listener, 1) < 0) {
+        perror(path.c_str());
+        close(listener);
+        return -1;
+    }
+    int fd = accept(listener, nullptr, nullptr);
+    close(listener);
+    unlink(path.c_str());
+    if (fd < 0) {
+        perror("accept");
+    }
+    return fd;
 }
 
-#include <deque>
-#include <algorithm>
-#include <climits>
-
-void roundRobinScheduling(vector<Process>& processes, int timeQuantum) {
-    int currentTime = 0;
-    deque<int> readyQueue;
-    int numProcesses = processes.size();
-    vector<int> remainingTime(numProcesses, 0);
-    int processesCompleted = 0;
-
-    // Initialize remaining times
-    for (int i = 0; i < numProcesses; i++) {
-        remainingTime[i] = processes[i].cpuBursts[processes[i].currentCpuBurst];
-    }
-
-    // Main Round Robin loop
-    while (processesCompleted < numProcesses) {
-        // Add new arrivals to the ready queue
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].arrivalTime <= currentTime && !processes[i].inIO && !processes[i].completed) {
-                if (find(readyQueue.begin(), readyQueue.end(), i) == readyQueue.end()) {
-                    readyQueue.push_back(i);
-                }
-            }
+void printOnlineMetrics(const OnlineMetrics& metrics) {
+    double utilisation = metrics.now > 0 ? 100.0 * metrics.busy / metrics.now : 0.0;
+    cout << "# time=" << metrics.now << " submitted=" << metrics.submitted << " completed=" << metrics.completed
+         << " late=" << metrics.late << " ATAT=" << metrics.averageTurnaround << " AWT=" << metrics.averageWaiting
+         << " utilisation=" << utilisation << "%\n";
+}
+
+// Shadow a live arrival stream: one workload line per process, in arrival
+// order. Decisions are printed as soon as they are final, and output is
+// flushed whenever the input has nothing more buffered.
+void runShadow(int fd, const PolicyConfig& config, long long reportEvery) {
+    static const char* const kinds[] = {"run", "preempt", "block", "exit"};
+    OnlineScheduler scheduler(config.policy, config.quantum, config.cpus.adaptive);
+    LineReader reader(fd);
+    string line;
+    Process p;
+    vector<Decision> decisions;
+
+    auto printDecisions = [&]() {
+        scheduler.drainDecisions(decisions);
+        for (const Decision& decision : decisions) {
+            cout << decision.time << ' ' << kinds[decision.kind] << ' ' << decision.process + 1 << '\n';
         }
+        decisions.clear();
+    };
 
-        // Check if any process has completed its I/O and is ready for the next CPU burst
-        for (int i = 0; i < numProcesses; i++) {
-            if (processes[i].inIO && processes[i].ioCompletionTime <= currentTime) {
-                processes[i].inIO = false;
-                if (find(readyQueue.begin(), readyQueue.end(), i) == readyQueue.end()) {
-                    readyQueue.push_back(i);
-                }
-            }
+    while (reader.next(line)) {
+        if (!parseWorkloadLine(line, p)) {
+            continue;
+        }
+        scheduler.advanceTo(p.arrivalTime);
+        scheduler.submit(p.spec());
+        printDecisions();
+        if (reportEvery > 0 && scheduler.metrics().submitted % reportEvery == 0) {
+            printOnlineMetrics(scheduler.metrics());
+        }
+        if (!reader.buffered()) {
+            cout.flush();
         }
+    }
 
-        if (!readyQueue.empty()) {
-            int processID = readyQueue.front();
-            readyQueue.pop_front();
-
-            Process& process = processes[processID];
-            int timeSlice = min(timeQuantum, remainingTime[processID]);
-
-            cout << "Executing Process " << processID + 1 << " for " << timeSlice << " units\n";
-            currentTime += timeSlice;
-            remainingTime[processID] -= timeSlice;
-
-            // If process completed its CPU burst
-            if (remainingTime[processID] == 0) {
-                process.currentCpuBurst++;
-                if (process.currentCpuBurst < process.cpuBursts.size()) {
-                    // Move to I/O
-                    process.inIO = true;
-                    process.ioCompletionTime = currentTime + process.ioBursts[process.currentIoBurst++];
-                } else {
-                    // Process is completed
-                    process.completionTime = currentTime;
-                    process.completed = true;
-                    processesCompleted++;
-                }
-            }
+    scheduler.finish();
+    printDecisions();
+    printOnlineMetrics(scheduler.metrics());
+    cout.flush();
+}
 
-            // Re-add to the ready queue if not completed
-            if (!process.completed && remainingTime[processID] > 0) {
-                readyQueue.push_back(processID);
+int main(int argc, char* argv[]) {
+    ios::sync_with_stdio(false);
+
+    // Options may appear anywhere; everything else is positional
+    vector<string> args;
+    PolicyConfig config;
+    ReplicaConfig replicas;
+    bool useReplicas = false;
+    bool online = false;
+    string socketPath;
+    long long reportEvery = 0;
+    bool useCache = true;
+    string cacheDirectory = ResultCache::defaultDirectory();
+    unsigned long long cacheMegabytes = 64;
+    vector<string> whatIfPaths;
+    SimTime checkpointInterval = 0;
+    bool traceInput = false;
+    bool pipelined = false;
+    ClusterConfig cluster;
+    bool clustered = false;
+    string pluginPath;
+    string telemetryPath = "telemetry.csv";
+    int benchmarkRuns = 0;
+    string importPath;
+    TraceConfig trace;
+    config.cpus.adaptive = defaultAdaptiveConfig();
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        if (arg.rfind("--cpus=", 0) == 0) {
+            config.cpus.cpus = stoi(arg.substr(7));
+        } else if (arg.rfind("--threads=", 0) == 0) {
+            config.cpus.threads = stoi(arg.substr(10));
+        } else if (arg.rfind("--balance=", 0) == 0) {
+            config.cpus.balanceInterval = stoll(arg.substr(10));
+        } else if (arg.rfind("--replicas=", 0) == 0) {
+            replicas.replicas = stoi(arg.substr(11));
+            useReplicas = true;
+        } else if (arg.rfind("--jitter=", 0) == 0) {
+            if (!parseJitter(arg.substr(9), replicas)) {
+                cerr << "Invalid jitter " << arg.substr(9) << ", expected <uniform|normal>:<scale>" << endl;
+                return 1;
             }
-        } else {
-            // Advance time to the next event
-            int nextEventTime = INT_MAX;
-            for (int i = 0; i < numProcesses; i++) {
-                if (!processes[i].completed) {
-                    if (processes[i].arrivalTime > currentTime) {
-                        nextEventTime = min(nextEventTime, processes[i].arrivalTime);
-                    }
-                    if (processes[i].inIO) {
-                        nextEventTime = min(nextEventTime, processes[i].ioCompletionTime);
-                    }
-                }
+        } else if (arg.rfind("--seed=", 0) == 0) {
+            replicas.seed = stoull(arg.substr(7));
+        } else if (arg == "--online") {
+            online = true;
+        } else if (arg.rfind("--online=", 0) == 0) {
+            online = true;
+            socketPath = arg.substr(9);
+        } else if (arg.rfind("--report=", 0) == 0) {
+            reportEvery = stoll(arg.substr(9));
+        } else if (arg == "--no-cache") {
+            useCache = false;
+        } else if (arg.rfind("--cache-dir=", 0) == 0) {
+            cacheDirectory = arg.substr(12);
+        } else if (arg.rfind("--cache-size=", 0) == 0) {
+            cacheMegabytes = stoull(arg.substr(13));
+        } else if (arg.rfind("--what-if=", 0) == 0) {
+            whatIfPaths.push_back(arg.substr(10));
+        } else if (arg.rfind("--checkpoint=", 0) == 0) {
+            checkpointInterval = stoll(arg.substr(13));
+        } else if (arg.rfind("--adaptive=", 0) == 0) {
+            if (!parseAdaptiveRules(arg.substr(11), config.cpus.adaptive)) {
+                cerr << "Invalid adaptive rules " << arg.substr(11)
+                     << ", expected <FIFO|SJF|SRTF|RR>[:<depth|cv|short><op><value>],..." << endl;
+                return 1;
             }
-
-            if (nextEventTime != INT_MAX) {
-                currentTime = nextEventTime;
-                cout << "No process ready at time " << currentTime << ". Advancing time." << endl;
+        } else if (arg.rfind("--window=", 0) == 0) {
+            config.cpus.adaptive.window = stoi(arg.substr(9));
+        } else if (arg.rfind("--switch-cost=", 0) == 0) {
+            config.cpus.costs.contextSwitch = stoll(arg.substr(14));
+        } else if (arg.rfind("--migration-cost=", 0) == 0) {
+            config.cpus.costs.migration = stoll(arg.substr(17));
+        } else if (arg.rfind("--cold-cost=", 0) == 0) {
+            config.cpus.costs.cacheCold = stoll(arg.substr(12));
+        } else if (arg.rfind("--devices=", 0) == 0) {
+            if (!parseDevices(arg.substr(10), config.cpus.devices)) {
+                cerr << "Invalid devices " << arg.substr(10)
+                     << ", expected <channels>[:<FIFO|SSTF|DEADLINE>[:<expire>]],..." << endl;
+                return 1;
             }
+        } else if (arg == "--trace") {
+            traceInput = true;
+        } else if (arg.rfind("--trace-unit=", 0) == 0) {
+            trace.resolution = stoll(arg.substr(13));
+        } else if (arg == "--gang") {
+            config.cpus.gang = true;
+        } else if (arg == "--pipeline") {
+            pipelined = true;
+        } else if (arg.rfind("--cluster=", 0) == 0) {
+            cluster.servers = stoi(arg.substr(10));
+            clustered = true;
+        } else if (arg.rfind("--dispatch=", 0) == 0) {
+            if (!parseDispatch(arg.substr(11), cluster)) {
+                cerr << "Invalid dispatch " << arg.substr(11) << ", expected <random|rr|jsq|pod[:d]>" << endl;
+                return 1;
+            }
+        } else if (arg.rfind("--plugin=", 0) == 0) {
+            pluginPath = arg.substr(9);
+        } else if (arg.rfind("--telemetry=", 0) == 0) {
+            config.cpus.telemetryWindow = stoll(arg.substr(12));
+        } else if (arg.rfind("--telemetry-out=", 0) == 0) {
+            telemetryPath = arg.substr(16);
+        } else if (arg.rfind("--benchmark=", 0) == 0) {
+            benchmarkRuns = stoi(arg.substr(12));
+        } else if (arg.rfind("--import=", 0) == 0) {
+            importPath = arg.substr(9);
+        } else {
+            args.push_back(arg);
         }
     }
 
-    // Compute turnaround and waiting times
-    for (auto& process : processes) {
-        process.totalCpuBurstTime = accumulate(process.cpuBursts.begin(), process.cpuBursts.end(), 0);
-        process.turnaroundTime = process.completionTime - process.arrivalTime;
-        process.waitingTime = process.turnaroundTime - process.totalCpuBurstTime;
+    if (!importPath.empty()) {
+        return importTrace(importPath, trace) ? 0 : 1;
     }
-}
 
+    // The online stream replaces the workload file
+    if (online) {
+        args.insert(args.begin() + min<size_t>(1, args.size()), socketPath.empty() ? "-" : socketPath);
+    }
 
-void calculateAndPrintMetrics(const vector<Process>& processes) {
-    double totalTAT = 0, totalWT = 0;
-    int numProcesses = processes.size();
+    if (args.size() != 2 && args.size() != 3) {
+        cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file> [<Time Quantum>]"
+             << " [--cpus=N] [--threads=N] [--balance=T] [--replicas=R] [--jitter=<uniform|normal>:S] [--seed=N]"
+             << " [--no-cache] [--cache-dir=DIR] [--cache-size=MB] [--what-if=DIFF]... [--checkpoint=T]"
+             << " [--adaptive=RULES] [--window=N] [--trace] [--trace-unit=NS]"
+             << " [--switch-cost=T] [--migration-cost=T] [--cold-cost=T] [--devices=SPEC] [--gang] [--plugin=LIB]"
+             << " [--telemetry=WIDTH] [--telemetry-out=<file.csv|file.bin>]" << endl;
+        cerr << "       " << argv[0] << " <algorithm>,<algorithm>... <path-to-workload-description-file> [<Time Quantum>]"
+             << " --benchmark=RUNS [--plugin=LIB]" << endl;
+        cerr << "       " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file> [<Time Quantum>] --pipeline" << endl;
+        cerr << "       " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file> [<Time Quantum>]"
+             << " --cluster=SERVERS [--dispatch=<random|rr|jsq|pod[:d]>] [--seed=N]" << endl;
+        cerr << "       " << argv[0] << " <scheduling-algorithm> [<Time Quantum>] --online[=<socket-path>] [--report=N]" << endl;
+        cerr << "       " << argv[0] << " --import=<trace-file> [--trace-unit=NS]" << endl;
+        return 1;
+    }
 
-    cout << "\nProcess\tArrival Time\tTotalCpuBurst\tCompletion Time\tTAT\tWT\n";
-    for (const auto& process : processes) {
-        cout << "P" << (&process - &processes[0]) + 1 << "\t"
-             << process.arrivalTime << "\t\t"
-             << process.totalCpuBurstTime <<"\t\t"
-             << process.completionTime << "\t\t"
-             << process.turnaroundTime << "\t"
-             << process.waitingTime << "\n";
-            
+    string schedulingAlgorithm = args[0];
+    string filePath = args[1];
 
-        totalTAT += process.turnaroundTime;
-        totalWT += process.waitingTime;
+    // Replica runs may compare several algorithms, e.g. FIFO,SRTF,RR
+    vector<Policy> policies;
+    stringstream algorithmList(schedulingAlgorithm);
+    for (string name; getline(algorithmList, name, ',');) {
+        Policy policy;
+        if (!parsePolicy(name, policy)) {
+            cerr << "Unsupported scheduling algorithm!" << endl;
+            return 1;
+        }
+        policies.push_back(policy);
+    }
+    if (policies.empty() || (policies.size() > 1 && !useReplicas && benchmarkRuns == 0)) {
+        cerr << "Unsupported scheduling algorithm!" << endl;
+        return 1;
     }
 
-    double averageTAT = totalTAT / numProcesses;
-    double averageWT = totalWT / numProcesses;
-
-    cout << "\nAverage Turnaround Time (ATAT): " << averageTAT << endl;
-    cout << "Average Waiting Time (AWT): " << averageWT << endl;
-}
-int main(int argc, char* argv[]) {
-    if (argc != 3 && argc != 4) {
-        cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file> [<Time Quantum>]" << endl;
+    if (find(policies.begin(), policies.end(), POLICY_RR) != policies.end() && args.size() != 3) {
+        cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file> <Time Quantum>" << endl;
         return 1;
     }
+    if (args.size() == 3) {
+        config.quantum = stoi(args[2]);  // RR time quantum, or the CFS slice
+    }
+
+    // PLUGIN runs the policy in the shared object given by --plugin
+    unique_ptr<PolicyPlugin> plugin;
+    if (find(policies.begin(), policies.end(), POLICY_PLUGIN) != policies.end()) {
+        if (pluginPath.empty()) {
+            cerr << "PLUGIN needs --plugin=<shared-object>" << endl;
+            return 1;
+        }
+        try {
+            plugin.reset(new PolicyPlugin(pluginPath));
+        } catch (const invalid_argument& e) {
+            cerr << "Invalid plugin: " << e.what() << endl;
+            return 1;
+        }
+        config.cpus.plugin = plugin->api();
+    }
 
-    string schedulingAlgorithm = argv[1];
-    string filePath = argv[2];
+    if (online) {
+        if (policies.size() > 1 || config.cpus.cpus != 1) {
+            cerr << "Online mode runs a single policy on one CPU" << endl;
+            return 1;
+        }
+        if (policies[0] == POLICY_RM) {
+            cerr << "RM ranks the periods of the whole workload and cannot run online" << endl;
+            return 1;
+        }
+        if (policies[0] == POLICY_PLUGIN) {
+            cerr << "Policy plugins cannot run online" << endl;
+            return 1;
+        }
+        const MultiCpuConfig& engine = config.cpus;
+        if (!engine.devices.empty() || engine.costs.any() || engine.gang || engine.telemetryWindow > 0) {
+            cerr << "Online mode models no devices, switch costs, gangs or telemetry" << endl;
+            return 1;
+        }
+        config.policy = policies[0];
+        int fd = socketPath.empty() ? STDIN_FILENO : acceptUnixSocket(socketPath);
+        if (fd < 0) {
+            return 1;
+        }
+        runShadow(fd, config, reportEvery);
+        return 0;
+    }
 
-    int tq = 0;
-    if (schedulingAlgorithm == "RR") {
-        if (argc != 4) {
-            cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file> <Time Quantum>" << endl;
+    if (clustered) {
+        // Dispatch the workload over the servers; "-" reads stdin
+        ifstream infile;
+        if (filePath != "-") {
+            infile.open(filePath);
+            if (!infile) {
+                cerr << "Cannot open " << filePath << endl;
+                return 1;
+            }
+        }
+        config.policy = policies[0];
+        cluster.seed = replicas.seed;
+        try {
+            printClusterSummary(runCluster(filePath == "-" ? cin : infile, config, cluster), config, cluster);
+        } catch (const invalid_argument& e) {
+            cerr << "Invalid configuration: " << e.what() << endl;
             return 1;
         }
-        tq = stoi(argv[3]);  // Convert the third argument to an integer for the time quantum
-    } else {
-        if (argc != 3) {
-            cerr << "Usage: " << argv[0] << " <scheduling-algorithm> <path-to-workload-description-file>" << endl;
+        return 0;
+    }
+
+    if (pipelined) {
+        // Parse, simulate and print on three threads; "-" reads stdin
+        ifstream infile;
+        if (filePath != "-") {
+            infile.open(filePath);
+            if (!infile) {
+                cerr << "Cannot open " << filePath << endl;
+                return 1;
+            }
+        }
+        config.policy = policies[0];
+        try {
+            PrintingSink sink(false);
+            PipelineStats stats = runPipeline(filePath == "-" ? cin : infile, config, sink);
+            if (stats.late > 0) {
+                cerr << stats.late << " processes arrived out of order and were queued late" << endl;
+            }
+        } catch (const invalid_argument& e) {
+            cerr << "Invalid configuration: " << e.what() << endl;
             return 1;
         }
+        return 0;
     }
 
-    vector<Process> processes = readWorkloadFile(filePath);
+    vector<Process> processes = traceInput ? readTraceFile(filePath, trace) : readWorkloadFile(filePath);
+    vector<ProcessSpec> specs = processSpecs(processes);
 
-    if (schedulingAlgorithm == "FIFO") {
-        fifoScheduling(processes);
-    } else if (schedulingAlgorithm == "SJF") {
-        sjfScheduling(processes);
-    } else if (schedulingAlgorithm == "SRTF") {
-        srtfScheduling(processes);
-    } else if (schedulingAlgorithm == "CFS") {
-        cfsScheduling(processes);
-    } else if (schedulingAlgorithm == "RR") {
-        roundRobinScheduling(processes, tq);
-    } else {
-        cerr << "Unsupported scheduling algorithm!" << endl;
+    try {
+        if (benchmarkRuns > 0) {
+            printPolicyTimings(timePolicies(specs, policies, config, benchmarkRuns), plugin.get());
+            return 0;
+        }
+        if (useReplicas) {
+            for (Policy policy : policies) {
+                PolicyConfig replicaConfig = config;
+                replicaConfig.policy = policy;
+                validateRun(specs, replicaConfig);
+            }
+            replicas.threads = config.cpus.threads;
+            replicas.engine = config.cpus;
+            printReplicaSummaries(replicaScheduling(specs, policies, config.quantum, replicas), replicas);
+            return 0;
+        }
+
+        config.policy = policies[0];
+        if (!whatIfPaths.empty()) {
+            // One baseline run, then every diff resumes from its checkpoints
+            WhatIfSession session(specs, config, true, checkpointInterval);
+            for (const string& path : whatIfPaths) {
+                vector<pair<size_t, Process>> diff;
+                if (!readWorkloadChanges(path, diff)) {
+                    cerr << "Invalid what-if file " << path << endl;
+                    return 1;
+                }
+                vector<WorkloadChange> changes;
+                for (const pair<size_t, Process>& change : diff) {
+                    changes.push_back({change.first, change.second.spec()});
+                }
+                cout << "=== What-if " << path << " ===\n";
+                PrintingSink sink(config.cpus.cpus > 1, telemetryPath);
+                session.simulate(changes, sink);
+                cout << "Resumed from time " << session.lastResumeTime() << "\n\n";
+            }
+            return 0;
+        }
+
+        PrintingSink sink(config.cpus.cpus > 1, telemetryPath);
+        if (useCache) {
+            ResultCache cache(cacheDirectory, cacheMegabytes << 20);
+            cache.simulate(specs, config, sink);
+        } else {
+            simulate(specs, config, sink);
+        }
+    } catch (const invalid_argument& e) {
+        cerr << "Invalid configuration: " << e.what() << endl;
         return 1;
     }
 
-    calculateAndPrintMetrics(processes);
-
     return 0;
 }
\ No newline at end of file
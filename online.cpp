@@ -0,0 +1,98 @@
+#include "online.h"
+
+#include <algorithm>
+using namespace std;
+
+
+OnlineScheduler::OnlineScheduler(Policy policy, int quantum, const AdaptiveConfig& adaptive)
+    : adaptive(adaptive.rules.empty() ? defaultAdaptiveConfig() : adaptive) {
+    cpu.policy = policy;
+    cpu.quantum = max(1, quantum);
+    cpu.recordSchedule = false;
+    cpu.tasks = &tasks;
+    cpu.decisions = &log;
+    cpu.ready.fifo = (policy == POLICY_FIFO || policy == POLICY_RR);
+    if (policy == POLICY_ADAPTIVE) {
+        cpu.useAdaptive(&this->adaptive);
+    }
+}
+
+long long OnlineScheduler::submit(const ProcessSpec& submitted) {
+    ProcessSpec process = threadSpec(submitted, 0);
+    int slot;
+    if (freeSlots.empty()) {
+        slot = specs.size();
+        specs.emplace_back();
+        tasks.emplace_back();
+        bursts.emplace_back();
+        runs.emplace_back();
+        externalId.push_back(0);
+        cpu.processes = specs.data();
+    } else {
+        slot = freeSlots.back();
+        freeSlots.pop_back();
+    }
+
+    vector<int>& storage = bursts[slot];
+    storage.assign(process.cpuBursts.begin(), process.cpuBursts.end());
+    storage.insert(storage.end(), process.ioBursts.begin(), process.ioBursts.end());
+    storage.insert(storage.end(), process.tokens.begin(), process.tokens.end());
+    runs[slot].assign(process.runs.begin(), process.runs.end());
+
+    ProcessSpec& spec = specs[slot];
+    spec.arrival = process.arrival;
+    if (spec.arrival < cpu.now) {
+        spec.arrival = cpu.now;
+        stats.late++;
+    }
+    spec.cpuBursts = Span<int>(storage.data(), process.cpuBursts.size());
+    spec.ioBursts = Span<int>(storage.data() + process.cpuBursts.size(), process.ioBursts.size());
+    spec.tokens = Span<int>(storage.data() + process.cpuBursts.size() + process.ioBursts.size(), process.tokens.size());
+    spec.runs = runs[slot];
+    spec.period = process.period;
+    spec.deadline = process.deadline;
+
+    tasks[slot] = startTask(spec);
+    externalId[slot] = stats.submitted++;
+    cpu.arrivals.push_back(slot);
+    return externalId[slot];
+}
+
+void OnlineScheduler::advanceTo(SimTime t) {
+    cpu.advance(t);
+
+    // Translate slots to process ids before any slot can be reused
+    for (const Decision& decision : log) {
+        int slot = decision.process;
+        pending.push_back({decision.time, externalId[slot], decision.kind});
+        if (decision.kind == DECISION_EXIT) {
+            const ProcessSpec& spec = specs[slot];
+            SimTime turnaround = decision.time - spec.arrival;
+            totalTurnaround += turnaround;
+            totalWaiting += turnaround - totalCpuTime(spec);
+            stats.completed++;
+            freeSlots.push_back(slot);
+        }
+    }
+    log.clear();
+
+    if (stats.completed > 0) {
+        stats.averageTurnaround = totalTurnaround / stats.completed;
+        stats.averageWaiting = totalWaiting / stats.completed;
+    }
+    stats.busy = cpu.busy;
+    stats.now = cpu.now;
+
+    // Drop consumed arrivals once they make up half of the list
+    if (cpu.nextArrival >= 1024 && cpu.nextArrival * 2 >= cpu.arrivals.size()) {
+        cpu.arrivals.erase(cpu.arrivals.begin(), cpu.arrivals.begin() + cpu.nextArrival);
+        cpu.nextArrival = 0;
+    }
+}
+
+size_t OnlineScheduler::drainDecisions(vector<Decision>& out) {
+    size_t count = pending.size();
+    out.insert(out.end(), pending.begin(), pending.end());
+    pending.clear();
+    return count;
+}
@@ -0,0 +1,63 @@
+#ifndef ONLINE_H
+#define ONLINE_H
+
+#include <vector>
+#include "engine.h"
+#include "workload.h"
+
+struct OnlineMetrics {
+    long long submitted = 0;
+    long long completed = 0;
+    long long late = 0;             // Submissions that arrived behind the engine clock
+    double averageTurnaround = 0;
+    double averageWaiting = 0;
+    SimTime busy = 0;               // CPU time handed out so far
+    SimTime now = 0;
+};
+
+// Single-CPU engine fed one process at a time, for shadowing a live arrival
+// stream. Memory is bounded by the processes still in the system: a
+// completed process's slot is reused by the next submission.
+class OnlineScheduler {
+public:
+    // `adaptive` holds the rules for POLICY_ADAPTIVE; empty means the defaults
+    OnlineScheduler(Policy policy, int quantum, const AdaptiveConfig& adaptive = AdaptiveConfig());
+
+    // Queue a process; its bursts are copied. An arrival earlier than the
+    // engine clock counts as late and arrives now. Returns the process id,
+    // numbered from 0 in submission order. Groups are not simulated online,
+    // and a multi-threaded process runs as its first thread.
+    long long submit(const ProcessSpec& process);
+
+    // Make every decision that happens before time t. Decisions are final:
+    // later submissions cannot arrive before t.
+    void advanceTo(SimTime t);
+
+    // Run until every submitted process has completed
+    void finish() { advanceTo(NEVER); }
+
+    // Append the decisions made since the last drain to `out`; returns how many
+    size_t drainDecisions(std::vector<Decision>& out);
+
+    const OnlineMetrics& metrics() const { return stats; }
+
+    // Discipline changes of POLICY_ADAPTIVE so far
+    const std::vector<PolicySwitch>& policySwitches() const { return cpu.switches; }
+
+private:
+    AdaptiveConfig adaptive;
+    Cpu cpu;
+    std::vector<ProcessSpec> specs;
+    std::vector<Task> tasks;
+    std::vector<std::vector<int>> bursts;   // CPU bursts, I/O bursts, then run tokens of every slot
+    std::vector<std::vector<BurstRun>> runs;
+    std::vector<long long> externalId;
+    std::vector<int> freeSlots;
+    std::vector<Decision> log;              // Decisions of the current advanceTo, by slot
+    std::vector<Decision> pending;          // Decisions not yet drained, by process id
+    double totalTurnaround = 0;
+    double totalWaiting = 0;
+    OnlineMetrics stats;
+};
+
+#endif // ONLINE_H
@@ -0,0 +1,148 @@
+#include "pipeline.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include "online.h"
+using namespace std;
+
+
+// Simulator to writer: a submitted process or a scheduling decision
+struct PipelineEvent {
+    bool submitted = false;
+    Decision decision = {0, 0, DECISION_RUN};   // A submission carries its arrival and id
+    SimTime cpuTime = 0;                        // Total CPU time of a submitted process
+};
+
+// Rebuilds segments and per-process metrics from the decision stream and
+// returns the summary for the simulator to complete
+static RunSummary writeOutput(SpscRing<PipelineEvent>& events, MetricsSink& sink) {
+    bool wantsSchedule = sink.wantsSchedule();
+    vector<ProcessMetrics> processes;
+    vector<int> bursts;
+    long long running = -1;
+    SimTime runStart = 0;
+    SimTime busy = 0;
+
+    PipelineEvent event;
+    while (events.pop(event)) {
+        const Decision& decision = event.decision;
+        if (event.submitted) {
+            ProcessMetrics metrics = {};
+            metrics.process = decision.process;
+            metrics.arrival = decision.time;
+            metrics.totalCpuBurst = event.cpuTime;
+            processes.push_back(metrics);
+            bursts.push_back(0);
+            continue;
+        }
+        if (decision.kind == DECISION_RUN) {
+            running = decision.process;
+            runStart = decision.time;
+            continue;
+        }
+        if (decision.process == running) {
+            // Preempted, blocked or done: the running stretch ends here
+            busy += decision.time - runStart;
+            if (wantsSchedule && decision.time > runStart) {
+                sink.onSegment(0, {runStart, decision.time, (int)running, bursts[running]});
+            }
+            running = -1;
+        }
+        if (decision.kind == DECISION_BLOCK) {
+            bursts[decision.process]++;
+        } else if (decision.kind == DECISION_EXIT) {
+            processes[decision.process].completion = decision.time;
+        }
+    }
+
+    RunSummary summary;
+    summary.processes = processes.size();
+    double totalTAT = 0, totalWT = 0;
+    for (ProcessMetrics& metrics : processes) {
+        metrics.turnaround = metrics.completion - metrics.arrival;
+        metrics.waiting = metrics.turnaround - metrics.totalCpuBurst;
+        sink.onProcess(metrics);
+
+        totalTAT += metrics.turnaround;
+        totalWT += metrics.waiting;
+        summary.makespan = max(summary.makespan, metrics.completion);
+        summary.maxTurnaround = max(summary.maxTurnaround, metrics.turnaround);
+        summary.maxWaiting = max(summary.maxWaiting, metrics.waiting);
+    }
+    if (!processes.empty()) {
+        summary.averageTurnaround = totalTAT / processes.size();
+        summary.averageWaiting = totalWT / processes.size();
+    }
+    summary.busy.push_back(busy);
+    return summary;
+}
+
+PipelineStats runPipeline(istream& in, const PolicyConfig& config, MetricsSink& sink, size_t ringCapacity) {
+    if (config.policy == POLICY_RM || config.cpus.cpus != 1) {
+        throw invalid_argument("the pipeline runs one CPU and cannot rank RM periods up front");
+    }
+    if (config.policy == POLICY_PLUGIN) {
+        throw invalid_argument("policy plugins do not run in the pipeline");
+    }
+    const MultiCpuConfig& engine = config.cpus;
+    if (!engine.devices.empty() || engine.costs.any() || engine.gang || engine.telemetryWindow > 0) {
+        throw invalid_argument("the pipeline models no devices, switch costs, gangs or telemetry");
+    }
+    if (config.quantum < 1 && (config.policy == POLICY_RR || config.policy == POLICY_CFS)) {
+        throw invalid_argument("time quantum must be at least 1");
+    }
+
+    SpscRing<Process> parsed(ringCapacity);
+    SpscRing<PipelineEvent> events(ringCapacity);
+
+    thread parser([&]() {
+        string line;
+        Process p;
+        while (getline(in, line)) {
+            if (parseWorkloadLine(line, p)) {
+                parsed.push(move(p));
+            }
+        }
+        parsed.close();
+    });
+    RunSummary summary;
+    thread writer([&]() { summary = writeOutput(events, sink); });
+
+    PipelineStats stats;
+    OnlineScheduler scheduler(config.policy, config.quantum, config.cpus.adaptive);
+    vector<Decision> decisions;
+    auto forwardDecisions = [&]() {
+        scheduler.drainDecisions(decisions);
+        for (const Decision& decision : decisions) {
+            PipelineEvent event;
+            event.decision = decision;
+            events.push(event);
+        }
+        decisions.clear();
+    };
+
+    Process p;
+    while (parsed.pop(p)) {
+        ProcessSpec spec = threadSpec(p.spec(), 0);
+        scheduler.advanceTo(p.arrivalTime);
+        forwardDecisions();
+        PipelineEvent event;
+        event.submitted = true;
+        event.decision.process = scheduler.submit(spec);
+        event.decision.time = max<SimTime>(p.arrivalTime, scheduler.metrics().now);
+        event.cpuTime = totalCpuTime(spec);
+        events.push(event);
+        stats.processes++;
+    }
+    scheduler.finish();
+    forwardDecisions();
+    events.close();
+
+    parser.join();
+    writer.join();
+    summary.switches = scheduler.policySwitches();
+    sink.onSummary(summary);
+    stats.late = scheduler.metrics().late;
+    return stats;
+}
@@ -0,0 +1,105 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+
+#include <atomic>
+#include <istream>
+#include <thread>
+#include <vector>
+#include "simulator.h"
+
+// Bounded single-producer, single-consumer queue. The producer only writes
+// `tail` and the consumer only writes `head`; each keeps a cached copy of
+// the other's index, so the shared cache lines move only when the ring
+// looks full or empty. A full ring makes the producer wait (backpressure).
+template <typename T>
+class SpscRing {
+public:
+    // The capacity is rounded up to a power of two
+    explicit SpscRing(size_t capacity) {
+        size_t size = 2;
+        while (size < capacity) {
+            size *= 2;
+        }
+        slots.resize(size);
+        mask = size - 1;
+    }
+
+    bool tryPush(T& value) {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cachedHead > mask) {
+            cachedHead = head.load(std::memory_order_acquire);
+            if (t - cachedHead > mask) {
+                return false;
+            }
+        }
+        slots[t & mask] = std::move(value);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cachedTail) {
+            cachedTail = tail.load(std::memory_order_acquire);
+            if (h == cachedTail) {
+                return false;
+            }
+        }
+        value = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Wait for room, then push
+    void push(T value) {
+        for (int spins = 0; !tryPush(value); spins++) {
+            if (spins >= 64) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Wait for a value; false once the ring is closed and empty
+    bool pop(T& value) {
+        for (int spins = 0; !tryPop(value); spins++) {
+            if (closed.load(std::memory_order_acquire)) {
+                return tryPop(value);   // Values pushed just before closing
+            }
+            if (spins >= 64) {
+                std::this_thread::yield();
+            }
+        }
+        return true;
+    }
+
+    // Producer: no more values will follow
+    void close() { closed.store(true, std::memory_order_release); }
+
+private:
+    std::vector<T> slots;
+    size_t mask;
+    alignas(64) std::atomic<size_t> head{0};    // Next slot to pop
+    alignas(64) std::atomic<size_t> tail{0};    // Next slot to fill
+    alignas(64) std::atomic<bool> closed{false};
+    alignas(64) size_t cachedHead = 0;          // Producer's view of head
+    alignas(64) size_t cachedTail = 0;          // Consumer's view of tail
+};
+
+struct PipelineStats {
+    long long processes = 0;
+    long long late = 0;             // Lines with an arrival before the latest one read; queued at it
+};
+
+// Parse, simulate and report on three threads connected by SPSC rings: the
+// parser turns workload lines into processes, the simulator feeds them in
+// arrival order to an OnlineScheduler, and the writer rebuilds the schedule
+// and per-process metrics from its decisions and drives the sink. The
+// input must be sorted by arrival; an earlier arrival is taken as arriving
+// late, as in online mode. Runs on one CPU without groups, devices or
+// threads (a process runs as its first thread); the summary has no
+// deadline or device metrics. Throws std::invalid_argument for RM, PLUGIN,
+// more than one CPU, devices, switch costs, gangs or telemetry.
+PipelineStats runPipeline(std::istream& in, const PolicyConfig& config, MetricsSink& sink,
+                          size_t ringCapacity = 4096);
+
+#endif // PIPELINE_H
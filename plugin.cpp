@@ -0,0 +1,60 @@
+#include "plugin.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+#include <dlfcn.h>
+using namespace std;
+
+
+PolicyPlugin::PolicyPlugin(const string& path) {
+    handle = dlopen(path.c_str(), RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        throw invalid_argument(string("cannot load plugin: ") + dlerror());
+    }
+    auto entry = reinterpret_cast<sched_plugin_entry>(dlsym(handle, SCHED_PLUGIN_ENTRY));
+    table = entry ? entry() : nullptr;
+    string problem;
+    if (!entry) {
+        problem = path + " does not export " SCHED_PLUGIN_ENTRY;
+    } else if (!table || table->abi_version != SCHED_PLUGIN_ABI_VERSION) {
+        problem = path + " was built for another plugin ABI version";
+    } else if (!table->enqueue || !table->dequeue || !table->pick_next) {
+        problem = path + " lacks the enqueue, dequeue or pick_next hook";
+    }
+    if (!problem.empty()) {
+        dlclose(handle);
+        throw invalid_argument(problem);
+    }
+}
+
+PolicyPlugin::~PolicyPlugin() {
+    dlclose(handle);
+}
+
+vector<PolicyTiming> timePolicies(Span<ProcessSpec> processes, const vector<Policy>& policies,
+                                  const PolicyConfig& config, int runs) {
+    vector<PolicyTiming> timings;
+    for (Policy policy : policies) {
+        PolicyConfig run = config;
+        run.policy = policy;
+        PolicyTiming timing;
+        timing.policy = policy;
+        timing.runs = max(1, runs);
+        timing.minMillis = NEVER;
+        MultiCpuResult result = runEngine(processes, run, false);
+        double total = 0;
+        for (int r = 0; r < timing.runs; r++) {
+            auto start = chrono::steady_clock::now();
+            result = runEngine(processes, run, false);
+            double millis = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+            total += millis;
+            timing.minMillis = min(timing.minMillis, millis);
+        }
+        timing.meanMillis = total / timing.runs;
+        timing.contextSwitches = result.contextSwitches;
+        timing.pluginCalls = result.pluginCalls;
+        timings.push_back(timing);
+    }
+    return timings;
+}
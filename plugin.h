@@ -0,0 +1,45 @@
+#ifndef PLUGIN_H
+#define PLUGIN_H
+
+#include <string>
+#include <vector>
+#include "simulator.h"
+
+// A scheduling policy loaded from a shared object that exports
+// sched_policy_plugin() (see sched_plugin.h). Run it as POLICY_PLUGIN with
+// `config.cpus.plugin = plugin.api()`; the library stays loaded as long as
+// the object lives.
+class PolicyPlugin {
+public:
+    // Throws std::invalid_argument if the library cannot be loaded, has no
+    // entry point, was built for another ABI version or lacks a required hook
+    explicit PolicyPlugin(const std::string& path);
+    ~PolicyPlugin();
+    PolicyPlugin(const PolicyPlugin&) = delete;
+    PolicyPlugin& operator=(const PolicyPlugin&) = delete;
+
+    const sched_plugin* api() const { return table; }
+    std::string name() const { return table->name ? table->name : "PLUGIN"; }
+
+private:
+    void* handle = nullptr;
+    const sched_plugin* table = nullptr;
+};
+
+struct PolicyTiming {
+    Policy policy;
+    int runs = 0;
+    double meanMillis = 0;
+    double minMillis = 0;
+    long long contextSwitches = 0;  // Per run
+    long long pluginCalls = 0;      // Per run; 0 for native policies
+};
+
+// Time `runs` simulations of the workload under every policy, after one
+// untimed warm-up run each. The schedule is not recorded, so the times are
+// the engine's and the policy's alone. Throws std::invalid_argument for a
+// bad configuration.
+std::vector<PolicyTiming> timePolicies(Span<ProcessSpec> processes, const std::vector<Policy>& policies,
+                                       const PolicyConfig& config, int runs);
+
+#endif // PLUGIN_H
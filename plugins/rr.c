@@ -0,0 +1,88 @@
+/* Round robin as a policy plugin: a ring of task ids, one quantum per pick.
+   A task whose slice ends with nobody waiting keeps the CPU without a round
+   trip through the queue, which gives the metrics of the built-in RR with
+   fewer segments. */
+
+#include <stdlib.h>
+#include "sched_plugin.h"
+
+typedef struct {
+    int* ring;
+    size_t head, size, capacity;
+    long long quantum;
+} rr_state;
+
+static void* rr_create(int quantum) {
+    rr_state* s = calloc(1, sizeof(rr_state));
+    if (s) {
+        s->quantum = quantum;
+    }
+    return s;
+}
+
+static void rr_destroy(void* state) {
+    rr_state* s = state;
+    free(s->ring);
+    free(s);
+}
+
+static int rr_enqueue(void* state, long long now, const sched_task* tasks, size_t count) {
+    rr_state* s = state;
+    (void)now;
+    for (size_t k = 0; k < count; k++) {
+        if (s->size == s->capacity) {
+            size_t capacity = s->capacity ? 2 * s->capacity : 64;
+            int* ring = malloc(capacity * sizeof(int));
+            for (size_t i = 0; i < s->size; i++) {
+                ring[i] = s->ring[(s->head + i) % s->capacity];
+            }
+            free(s->ring);
+            s->ring = ring;
+            s->head = 0;
+            s->capacity = capacity;
+        }
+        s->ring[(s->head + s->size++) % s->capacity] = tasks[k].id;
+    }
+    return 0;
+}
+
+static void rr_dequeue(void* state, long long now, const int* ids, size_t count) {
+    rr_state* s = state;
+    (void)now;
+    for (size_t k = 0; k < count; k++) {
+        size_t kept = 0;
+        for (size_t i = 0; i < s->size; i++) {
+            int id = s->ring[(s->head + i) % s->capacity];
+            if (id != ids[k]) {
+                s->ring[(s->head + kept++) % s->capacity] = id;
+            }
+        }
+        s->size = kept;
+    }
+}
+
+static int rr_pick_next(void* state, long long now, long long* slice) {
+    rr_state* s = state;
+    (void)now;
+    int id = s->ring[s->head];
+    s->head = (s->head + 1) % s->capacity;
+    s->size--;
+    *slice = s->quantum;
+    return id;
+}
+
+static long long rr_tick(void* state, long long now, const sched_task* running) {
+    rr_state* s = state;
+    (void)now;
+    (void)running;
+    return s->size == 0 ? s->quantum : 0;
+}
+
+static const sched_plugin plugin = {
+    SCHED_PLUGIN_ABI_VERSION, "RR plugin",
+    rr_create, rr_destroy, rr_enqueue, NULL, rr_dequeue, rr_pick_next, rr_tick
+};
+
+const sched_plugin* sched_policy_plugin(void) {
+    return &plugin;
+}
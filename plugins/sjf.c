@@ -0,0 +1,126 @@
+/* Shortest job first as a policy plugin: a binary heap on the remaining
+   time of the current burst, ties to the task queued first. Matches the
+   built-in SJF. */
+
+#include <stdlib.h>
+#include "sched_plugin.h"
+
+typedef struct {
+    long long key;
+    long long seq;
+    int id;
+} entry;
+
+typedef struct {
+    entry* heap;
+    size_t size, capacity;
+    long long* queuedSeq;           /* By task id: seq of its live entry, -1 if none */
+    size_t ids;
+    long long nextSeq;
+} sjf_state;
+
+static int before(const entry* a, const entry* b) {
+    return a->key != b->key ? a->key < b->key : a->seq < b->seq;
+}
+
+static void sift_up(sjf_state* s, size_t i) {
+    while (i > 0 && before(&s->heap[i], &s->heap[(i - 1) / 2])) {
+        entry t = s->heap[i];
+        s->heap[i] = s->heap[(i - 1) / 2];
+        s->heap[(i - 1) / 2] = t;
+        i = (i - 1) / 2;
+    }
+}
+
+static void sift_down(sjf_state* s, size_t i) {
+    for (;;) {
+        size_t best = i, l = 2 * i + 1, r = l + 1;
+        if (l < s->size && before(&s->heap[l], &s->heap[best])) {
+            best = l;
+        }
+        if (r < s->size && before(&s->heap[r], &s->heap[best])) {
+            best = r;
+        }
+        if (best == i) {
+            return;
+        }
+        entry t = s->heap[i];
+        s->heap[i] = s->heap[best];
+        s->heap[best] = t;
+        i = best;
+    }
+}
+
+static void* sjf_create(int quantum) {
+    (void)quantum;
+    return calloc(1, sizeof(sjf_state));
+}
+
+static void sjf_destroy(void* state) {
+    sjf_state* s = state;
+    free(s->heap);
+    free(s->queuedSeq);
+    free(s);
+}
+
+static int sjf_enqueue(void* state, long long now, const sched_task* tasks, size_t count) {
+    sjf_state* s = state;
+    (void)now;
+    for (size_t k = 0; k < count; k++) {
+        int id = tasks[k].id;
+        if ((size_t)id >= s->ids) {
+            size_t ids = s->ids ? s->ids : 64;
+            while (ids <= (size_t)id) {
+                ids *= 2;
+            }
+            s->queuedSeq = realloc(s->queuedSeq, ids * sizeof(long long));
+            for (size_t i = s->ids; i < ids; i++) {
+                s->queuedSeq[i] = -1;
+            }
+            s->ids = ids;
+        }
+        if (s->size == s->capacity) {
+            s->capacity = s->capacity ? 2 * s->capacity : 64;
+            s->heap = realloc(s->heap, s->capacity * sizeof(entry));
+        }
+        entry e = {tasks[k].remaining, s->nextSeq++, id};
+        s->queuedSeq[id] = e.seq;
+        s->heap[s->size++] = e;
+        sift_up(s, s->size - 1);
+    }
+    return 0;
+}
+
+/* Stolen tasks stay in the heap until they surface */
+static void sjf_dequeue(void* state, long long now, const int* ids, size_t count) {
+    sjf_state* s = state;
+    (void)now;
+    for (size_t k = 0; k < count; k++) {
+        s->queuedSeq[ids[k]] = -1;
+    }
+}
+
+static int sjf_pick_next(void* state, long long now, long long* slice) {
+    sjf_state* s = state;
+    (void)now;
+    (void)slice;
+    while (s->size > 0) {
+        entry top = s->heap[0];
+        s->heap[0] = s->heap[--s->size];
+        sift_down(s, 0);
+        if (s->queuedSeq[top.id] == top.seq) {
+            s->queuedSeq[top.id] = -1;
+            return top.id;
+        }
+    }
+    return -1;
+}
+
+static const sched_plugin plugin = {
+    SCHED_PLUGIN_ABI_VERSION, "SJF plugin",
+    sjf_create, sjf_destroy, sjf_enqueue, NULL, sjf_dequeue, sjf_pick_next, NULL
+};
+
+const sched_plugin* sched_policy_plugin(void) {
+    return &plugin;
+}
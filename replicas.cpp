@@ -0,0 +1,221 @@
+#include "replicas.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <random>
+#include <thread>
+using namespace std;
+
+
+bool parseJitter(const string& spec, ReplicaConfig& config) {
+    size_t colon = spec.find(':');
+    string name = spec.substr(0, colon);
+    if (name == "uniform") {
+        config.distribution = JITTER_UNIFORM;
+    } else if (name == "normal") {
+        config.distribution = JITTER_NORMAL;
+    } else {
+        return false;
+    }
+    if (colon != string::npos) {
+        config.scale = stod(spec.substr(colon + 1));
+    }
+    return config.scale >= 0;
+}
+
+// Replicas are jittered and simulated in blocks. Inside a block the jittered
+// values are stored slot-major, one contiguous row of replicas per burst, so
+// jittering is a flat loop over replicas for every slot.
+const int BLOCK = 64;
+
+// Two-sided 95% Student t quantiles for 1..30 degrees of freedom
+static const double T95[] = {
+    12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+    2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+    2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+
+static double t95(int degrees) {
+    if (degrees < 1) {
+        return 0.0;
+    }
+    return degrees <= 30 ? T95[degrees - 1] : 1.96;
+}
+
+static void summarise(const vector<double>& samples, double& mean, double& halfWidth) {
+    int n = samples.size();
+    double sum = 0;
+    for (double x : samples) {
+        sum += x;
+    }
+    mean = n > 0 ? sum / n : 0.0;
+    double squares = 0;
+    for (double x : samples) {
+        squares += (x - mean) * (x - mean);
+    }
+    halfWidth = n > 1 ? t95(n - 1) * sqrt(squares / (n - 1)) / sqrt((double)n) : 0.0;
+}
+
+vector<ReplicaSummary> replicaScheduling(Span<ProcessSpec> processes, const vector<Policy>& policies,
+                                         int quantum, const ReplicaConfig& config) {
+    int numProcesses = processes.size();
+    int numReplicas = max(1, config.replicas);
+    int numPolicies = policies.size();
+
+    // One slot per inter-arrival gap, CPU burst and I/O burst, in that order.
+    // Run-length processes get one slot per token instead, so every
+    // repetition of a group shares its jitter and nothing is expanded.
+    vector<int> slotStart(numProcesses + 1, 0);
+    vector<double> base;
+    vector<int> minimum;
+    SimTime previousArrival = 0;
+    for (int i = 0; i < numProcesses; i++) {
+        const ProcessSpec& p = processes[i];
+        slotStart[i] = base.size();
+        base.push_back(p.arrival - previousArrival);
+        minimum.push_back(0);
+        previousArrival = p.arrival;
+        for (int burst : p.cpuBursts) {
+            base.push_back(burst);
+            minimum.push_back(burst > 0 ? 1 : 0);
+        }
+        for (int burst : p.ioBursts) {
+            base.push_back(burst);
+            minimum.push_back(0);
+        }
+        size_t firstToken = base.size();
+        base.insert(base.end(), p.tokens.begin(), p.tokens.end());
+        minimum.resize(base.size(), 0);
+        long long position = 0;
+        size_t thread = 1;
+        for (size_t r = 0; r < p.runs.size(); r++) {
+            // Every thread's sequence starts with a CPU burst
+            for (; thread < p.threadRuns.size() && p.threadRuns[thread] == (int)r; thread++) {
+                position = 0;
+            }
+            const BurstRun& run = p.runs[r];
+            for (int j = 0; j < run.length; j++) {
+                // A token at an even position, or in a repeated odd-length run, is a CPU burst
+                bool cpu = (position + j) % 2 == 0 || (run.length % 2 == 1 && run.repeat > 1);
+                if (cpu && p.tokens[run.start + j] > 0) {
+                    minimum[firstToken + run.start + j] = 1;
+                }
+            }
+            position += (long long)run.length * run.repeat;
+        }
+    }
+    slotStart[numProcesses] = base.size();
+    int numSlots = base.size();
+
+    MultiCpuConfig engine = config.engine;
+    engine.threads = 1;
+    engine.recordSchedule = false;
+
+    // tat[p][r] and wt[p][r]: one array per policy, indexed by replica
+    vector<vector<double>> tat(numPolicies, vector<double>(numReplicas));
+    vector<vector<double>> wt(numPolicies, vector<double>(numReplicas));
+    vector<vector<double>> switches(numPolicies, vector<double>(numReplicas));
+    vector<vector<double>> overhead(numPolicies, vector<double>(numReplicas));
+
+    int numBlocks = (numReplicas + BLOCK - 1) / BLOCK;
+    atomic<int> nextBlock(0);
+
+    auto worker = [&]() {
+        vector<double> noise((size_t)numSlots * BLOCK);
+        vector<int> values((size_t)numSlots * BLOCK);
+
+        // The replica's bursts live in one buffer that the specs point into
+        vector<int> bursts(numSlots);
+        vector<ProcessSpec> replica(numProcesses);
+        vector<SimTime> longestCpu(numProcesses);
+        for (int i = 0; i < numProcesses; i++) {
+            const int* first = &bursts[slotStart[i] + 1];
+            size_t numCpu = processes[i].cpuBursts.size();
+            replica[i].cpuBursts = Span<int>(first, numCpu);
+            size_t numIo = processes[i].ioBursts.size();
+            replica[i].ioBursts = Span<int>(first + numCpu, numIo);
+            replica[i].tokens = Span<int>(first + numCpu + numIo, processes[i].tokens.size());
+            replica[i].runs = processes[i].runs;
+            replica[i].period = processes[i].period;
+            replica[i].deadline = processes[i].deadline;
+            replica[i].group = processes[i].group;
+            replica[i].weight = processes[i].weight;
+            replica[i].device = processes[i].device;
+            replica[i].threads = processes[i].threads;
+            replica[i].threadRuns = processes[i].threadRuns;
+        }
+
+        for (int block = nextBlock++; block < numBlocks; block = nextBlock++) {
+            int first = block * BLOCK;
+            int width = min(BLOCK, numReplicas - first);
+
+            // Each replica draws from its own stream, seeded by (seed, replica)
+            for (int r = 0; r < width; r++) {
+                seed_seq seq{(unsigned long long)config.seed, (unsigned long long)(first + r)};
+                mt19937_64 rng(seq);
+                normal_distribution<double> normal(0.0, 1.0);
+                uniform_real_distribution<double> uniform(-1.0, 1.0);
+                for (int s = 0; s < numSlots; s++) {
+                    noise[(size_t)s * BLOCK + r] = config.distribution == JITTER_NORMAL ? normal(rng) : uniform(rng);
+                }
+            }
+            for (int s = 0; s < numSlots; s++) {
+                const double* row = &noise[(size_t)s * BLOCK];
+                int* out = &values[(size_t)s * BLOCK];
+                double scaled = base[s] * config.scale;
+                for (int r = 0; r < width; r++) {
+                    out[r] = max(minimum[s], (int)lround(base[s] + scaled * row[r]));
+                }
+            }
+
+            for (int r = 0; r < width; r++) {
+                for (int s = 0; s < numSlots; s++) {
+                    bursts[s] = values[(size_t)s * BLOCK + r];
+                }
+                SimTime arrival = 0;
+                for (int i = 0; i < numProcesses; i++) {
+                    arrival += bursts[slotStart[i]];
+                    replica[i].arrival = arrival;
+                    longestCpu[i] = longestThreadCpuTime(replica[i]);
+                }
+
+                for (int k = 0; k < numPolicies; k++) {
+                    MultiCpuResult result = multiCpuScheduling(replica, policies[k], quantum, engine);
+                    double totalTAT = 0, totalWT = 0;
+                    for (int i = 0; i < numProcesses; i++) {
+                        SimTime turnaround = result.completion[i] - replica[i].arrival;
+                        totalTAT += turnaround;
+                        totalWT += turnaround - longestCpu[i];
+                    }
+                    tat[k][first + r] = numProcesses > 0 ? totalTAT / numProcesses : 0.0;
+                    wt[k][first + r] = numProcesses > 0 ? totalWT / numProcesses : 0.0;
+                    switches[k][first + r] = result.contextSwitches;
+                    overhead[k][first + r] = result.overhead;
+                }
+            }
+        }
+    };
+
+    int numThreads = min(max(1, config.threads), numBlocks);
+    vector<thread> workers;
+    for (int t = 1; t < numThreads; t++) {
+        workers.emplace_back(worker);
+    }
+    worker();
+    for (thread& t : workers) {
+        t.join();
+    }
+
+    vector<ReplicaSummary> summaries;
+    for (int k = 0; k < numPolicies; k++) {
+        ReplicaSummary summary;
+        summary.policy = policies[k];
+        summarise(tat[k], summary.meanTAT, summary.halfWidthTAT);
+        summarise(wt[k], summary.meanWT, summary.halfWidthWT);
+        double unused;
+        summarise(switches[k], summary.meanSwitches, unused);
+        summarise(overhead[k], summary.meanOverhead, unused);
+        summaries.push_back(summary);
+    }
+    return summaries;
+}
@@ -0,0 +1,40 @@
+#ifndef REPLICAS_H
+#define REPLICAS_H
+
+#include <string>
+#include <vector>
+#include "engine.h"
+#include "workload.h"
+
+enum JitterDistribution { JITTER_UNIFORM, JITTER_NORMAL };
+
+struct ReplicaConfig {
+    int replicas = 1;
+    int threads = 1;
+    JitterDistribution distribution = JITTER_NORMAL;
+    double scale = 0.1;             // Relative spread applied to inter-arrival gaps and bursts
+    unsigned long long seed = 1;
+    MultiCpuConfig engine;          // CPUs simulated inside every replica
+};
+
+// Parse "<uniform|normal>:<scale>", e.g. "normal:0.1"
+bool parseJitter(const std::string& spec, ReplicaConfig& config);
+
+struct ReplicaSummary {
+    Policy policy;
+    double meanTAT;
+    double halfWidthTAT;            // Half width of the 95% confidence interval
+    double meanWT;
+    double halfWidthWT;
+    double meanSwitches;            // Context switches per replica
+    double meanOverhead;            // Switch overhead per replica (see SwitchCosts)
+};
+
+// Simulate `config.replicas` jittered copies of the workload under every
+// policy and summarise ATAT and AWT across replicas. Replica r always sees
+// the same jitter, whatever the thread count.
+std::vector<ReplicaSummary> replicaScheduling(Span<ProcessSpec> processes,
+                                              const std::vector<Policy>& policies, int quantum,
+                                              const ReplicaConfig& config);
+
+#endif // REPLICAS_H
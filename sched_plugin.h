@@ -0,0 +1,74 @@
+#ifndef SCHED_PLUGIN_H
+#define SCHED_PLUGIN_H
+
+/* C ABI of scheduling-policy plugins. A plugin is a shared object that
+   exports sched_policy_plugin(), returning a table of hooks. Every CPU gets
+   its own state from create(), and its ready queue lives in the plugin: the
+   engine hands over tasks that become runnable and asks which one to run
+   next. Runs may happen on several host threads at once, so a plugin must
+   keep everything in the state create() returns.
+
+   Calls are batched: every task that became runnable at one instant on one
+   CPU arrives in a single enqueue() or wake() call. The task arrays are
+   only valid during the call. */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped whenever the tables below change incompatibly */
+#define SCHED_PLUGIN_ABI_VERSION 1
+
+#define SCHED_NO_DEADLINE (-1LL)
+
+/* A task as the engine shows it to a plugin */
+typedef struct {
+    int id;                         /* Unique among the tasks of a run */
+    int burst;                      /* Index of the current CPU burst */
+    long long arrival;
+    long long remaining;            /* CPU time left in the current burst */
+    long long deadline;             /* Absolute deadline of the current job, or SCHED_NO_DEADLINE */
+    long long period;               /* 0 for an aperiodic process */
+} sched_task;
+
+typedef struct {
+    unsigned int abi_version;       /* SCHED_PLUGIN_ABI_VERSION */
+    const char* name;
+
+    /* Per-CPU state; `quantum` is the run's time quantum. Optional: NULL
+       gives every hook a NULL state. */
+    void* (*create)(int quantum);
+    /* Optional */
+    void (*destroy)(void* state);
+
+    /* Tasks that arrived or came off the CPU with work left. Returns
+       nonzero to preempt the running task, which is then enqueued too. */
+    int (*enqueue)(void* state, long long now, const sched_task* tasks, size_t count);
+    /* Tasks back from I/O; as enqueue(). Optional: NULL calls enqueue(). */
+    int (*wake)(void* state, long long now, const sched_task* tasks, size_t count);
+    /* The engine took queued tasks away: to run them on another CPU, or
+       in place of a pick_next() that was not queued */
+    void (*dequeue)(void* state, long long now, const int* ids, size_t count);
+    /* Remove and return the id of the task to run next. `*slice` starts at
+       0, meaning the task runs until its burst ends; a positive slice ends
+       in tick() if the burst is still going. Called only when a task is
+       queued; a pick that is not queued runs the longest-queued task,
+       which leaves the plugin through dequeue(). */
+    int (*pick_next)(void* state, long long now, long long* slice);
+    /* The running task used up its slice. Returns the length of its next
+       slice, or 0 to put it back through enqueue() and pick again.
+       Optional: NULL always puts it back. */
+    long long (*tick)(void* state, long long now, const sched_task* running);
+} sched_plugin;
+
+/* The entry point every plugin exports */
+typedef const sched_plugin* (*sched_plugin_entry)(void);
+#define SCHED_PLUGIN_ENTRY "sched_policy_plugin"
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SCHED_PLUGIN_H */
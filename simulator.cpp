@@ -0,0 +1,236 @@
+#include "simulator.h"
+
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+
+void CollectingSink::onSegment(int cpu, const Segment& segment) {
+    if ((int)schedule.size() <= cpu) {
+        schedule.resize(cpu + 1);
+    }
+    schedule[cpu].push_back(segment);
+}
+
+void validateRun(Span<ProcessSpec> processes, const PolicyConfig& config) {
+    bool usesQuantum = config.policy == POLICY_RR || config.policy == POLICY_CFS || config.policy == POLICY_ADAPTIVE;
+    if (config.quantum < 1 && usesQuantum) {
+        throw invalid_argument("time quantum must be at least 1");
+    }
+    if (config.cpus.cpus < 1 || config.cpus.threads < 1) {
+        throw invalid_argument("need at least one CPU and one host thread");
+    }
+    const SwitchCosts& costs = config.cpus.costs;
+    if (costs.contextSwitch < 0 || costs.migration < 0 || costs.cacheCold < 0) {
+        throw invalid_argument("switch costs must not be negative");
+    }
+    if (config.cpus.telemetryWindow < 0 || (config.cpus.telemetryWindow > 0 && config.cpus.gang)) {
+        throw invalid_argument("telemetry needs a positive window and does not cover gang scheduling");
+    }
+    if (config.policy == POLICY_PLUGIN && !config.cpus.plugin) {
+        throw invalid_argument("PLUGIN needs a policy plugin to be loaded");
+    }
+    if (config.policy == POLICY_ADAPTIVE && config.cpus.adaptive.window < 1) {
+        throw invalid_argument("adaptive window must be at least 1");
+    }
+    for (const DeviceConfig& device : config.cpus.devices) {
+        if (device.channels < 1 || device.expire < 0) {
+            throw invalid_argument("a device needs at least one channel and a non-negative expiry");
+        }
+    }
+    if (config.cpus.gang) {
+        if (config.policy != POLICY_RR) {
+            throw invalid_argument("gang scheduling takes turns round-robin; use RR");
+        }
+        if (!config.cpus.devices.empty() || costs.any()) {
+            throw invalid_argument("gang scheduling models neither devices nor switch costs");
+        }
+    }
+    for (const ProcessSpec& p : processes) {
+        if (p.threads < 1 || (!p.threadRuns.empty() && (int)p.threadRuns.size() != p.threads)) {
+            throw invalid_argument("malformed process: thread count does not match its burst sequences");
+        }
+        for (size_t k = 0; k < p.threadRuns.size(); k++) {
+            int last = k + 1 < p.threadRuns.size() ? p.threadRuns[k + 1] : p.runs.size();
+            if (p.threadRuns[k] < 0 || p.threadRuns[k] > last) {
+                throw invalid_argument("malformed process: thread bursts outside its runs");
+            }
+        }
+        if (config.cpus.gang && p.threads > config.cpus.cpus) {
+            throw invalid_argument("a gang of " + to_string(p.threads) + " threads needs as many CPUs");
+        }
+        if (p.device >= (int)config.cpus.devices.size()) {
+            throw invalid_argument("malformed process: device " + to_string(p.device) + " is not configured");
+        }
+        if (p.arrival < 0 || p.ioBursts.size() + 1 < p.cpuBursts.size()) {
+            throw invalid_argument("malformed process: negative arrival or missing I/O burst");
+        }
+        if (p.period < 0 || p.deadline < 0 || p.weight < 0) {
+            throw invalid_argument("malformed process: negative period, deadline or weight");
+        }
+        for (Span<int> bursts : {p.cpuBursts, p.ioBursts, p.tokens}) {
+            if (any_of(bursts.begin(), bursts.end(), [](int burst) { return burst < 0; })) {
+                throw invalid_argument("malformed process: negative CPU or I/O burst");
+            }
+        }
+        for (const BurstRun& run : p.runs) {
+            if (run.length < 0 || run.repeat < 0) {
+                throw invalid_argument("malformed process: negative run length or repeat count");
+            }
+            if (run.start < 0 || (size_t)run.start + run.length > p.tokens.size()) {
+                throw invalid_argument("malformed process: burst run outside its tokens");
+            }
+        }
+    }
+}
+
+MultiCpuResult runEngine(Span<ProcessSpec> processes, const PolicyConfig& config, bool recordSchedule) {
+    validateRun(processes, config);
+    MultiCpuConfig engine = config.cpus;
+    engine.recordSchedule = recordSchedule;
+    return multiCpuScheduling(processes, config.policy, config.quantum, engine);
+}
+
+// Nearest-rank percentile: the smallest value with at least `percent`% of
+// the values at or below it. Reorders the values
+template <typename T>
+static T percentile(vector<T>& values, int percent) {
+    size_t rank = max<size_t>(1, (percent * values.size() + 99) / 100) - 1;
+    nth_element(values.begin(), values.begin() + rank, values.end());
+    return values[rank];
+}
+
+static vector<GroupMetrics> groupMetrics(Span<ProcessSpec> processes, const MultiCpuResult& result) {
+    GroupTree tree = buildGroupTree(processes);
+    int numGroups = tree.path.size();
+    vector<GroupMetrics> groups(numGroups);
+    vector<vector<SimTime>> turnarounds(numGroups);
+    vector<double> totalWT(numGroups, 0.0);
+    for (int g = 0; g < numGroups; g++) {
+        groups[g].path = tree.path[g];
+    }
+    for (size_t i = 0; i < processes.size(); i++) {
+        SimTime cpuTime = totalCpuTime(processes[i]);
+        SimTime turnaround = result.completion[i] - processes[i].arrival;
+        SimTime waiting = turnaround - longestThreadCpuTime(processes[i]);
+        for (int g = tree.processGroup[i]; g >= 0; g = tree.parent[g]) {
+            groups[g].processes++;
+            groups[g].cpuTime += cpuTime;
+            groups[g].maxWaiting = max(groups[g].maxWaiting, waiting);
+            totalWT[g] += waiting;
+            turnarounds[g].push_back(turnaround);
+        }
+    }
+    for (int g = 0; g < numGroups; g++) {
+        vector<SimTime>& tat = turnarounds[g];
+        if (tat.empty()) {
+            continue;
+        }
+        double totalTAT = 0;
+        for (SimTime t : tat) {
+            totalTAT += t;
+        }
+        groups[g].averageTurnaround = totalTAT / tat.size();
+        groups[g].averageWaiting = totalWT[g] / tat.size();
+        groups[g].p95Turnaround = percentile(tat, 95);
+        groups[g].p99Turnaround = percentile(tat, 99);
+    }
+    return groups;
+}
+
+void reportRun(Span<ProcessSpec> processes, const MultiCpuResult& result, MetricsSink& sink,
+               const vector<DeviceConfig>& devices) {
+    for (size_t c = 0; c < result.schedule.size(); c++) {
+        for (const Segment& segment : result.schedule[c]) {
+            sink.onSegment(c, segment);
+        }
+    }
+
+    RunSummary summary;
+    summary.processes = processes.size();
+    double totalTAT = 0, totalWT = 0;
+    for (size_t i = 0; i < processes.size(); i++) {
+        ProcessMetrics metrics;
+        metrics.process = i;
+        metrics.arrival = processes[i].arrival;
+        metrics.totalCpuBurst = totalCpuTime(processes[i]);
+        metrics.completion = result.completion[i];
+        metrics.turnaround = metrics.completion - metrics.arrival;
+        metrics.waiting = metrics.turnaround - longestThreadCpuTime(processes[i]);
+        sink.onProcess(metrics);
+
+        totalTAT += metrics.turnaround;
+        totalWT += metrics.waiting;
+        summary.maxTurnaround = max(summary.maxTurnaround, metrics.turnaround);
+        summary.maxWaiting = max(summary.maxWaiting, metrics.waiting);
+    }
+    if (!processes.empty()) {
+        summary.averageTurnaround = totalTAT / processes.size();
+        summary.averageWaiting = totalWT / processes.size();
+    }
+    summary.makespan = result.makespan;
+    summary.migrations = result.migrations;
+    summary.contextSwitches = result.contextSwitches;
+    summary.overhead = result.overhead;
+    summary.busy = result.busy;
+    summary.switches = result.switches;
+    summary.slotTime = result.slotTime;
+    summary.unallocated = result.unallocated;
+    summary.stalled = result.stalled;
+    summary.gangRows = result.rows;
+    summary.telemetryWindow = result.telemetry.width;
+    summary.telemetry = telemetryWindows(result.telemetry, result.busy.size(), result.makespan);
+
+    vector<SimTime> lateness;
+    for (const vector<SimTime>& cpuLateness : result.lateness) {
+        lateness.insert(lateness.end(), cpuLateness.begin(), cpuLateness.end());
+    }
+    summary.deadlineJobs = lateness.size();
+    for (SimTime late : lateness) {
+        summary.missedDeadlines += late > 0;
+    }
+    if (!lateness.empty()) {
+        summary.latenessP50 = percentile(lateness, 50);
+        summary.latenessP90 = percentile(lateness, 90);
+        summary.latenessP99 = percentile(lateness, 99);
+        summary.latenessMax = *max_element(lateness.begin(), lateness.end());
+    }
+    for (const ProcessSpec& p : processes) {
+        long long jobs = cpuBurstCount(p);
+        if (p.period > 0 && jobs > 0) {
+            summary.periodicDemand += (double)totalCpuTime(p) / jobs / p.period;
+        }
+    }
+    bool hasGroups = false;
+    for (const ProcessSpec& p : processes) {
+        hasGroups = hasGroups || (p.group && *p.group) || p.weight > 0;
+    }
+    if (hasGroups) {
+        summary.groups = groupMetrics(processes, result);
+    }
+    for (size_t d = 0; d < result.deviceWaits.size(); d++) {
+        DeviceMetrics device;
+        device.channels = d < devices.size() ? devices[d].channels : 1;
+        vector<SimTime> waits = result.deviceWaits[d];
+        device.requests = waits.size();
+        double capacity = (double)device.channels * result.makespan;
+        device.utilisation = capacity > 0 ? result.deviceBusy[d] / capacity : 0.0;
+        if (!waits.empty()) {
+            double totalWait = 0;
+            for (SimTime wait : waits) {
+                totalWait += wait;
+            }
+            device.meanWait = totalWait / waits.size();
+            device.waitP50 = percentile(waits, 50);
+            device.waitP90 = percentile(waits, 90);
+            device.waitP99 = percentile(waits, 99);
+            device.waitMax = *max_element(waits.begin(), waits.end());
+        }
+        summary.devices.push_back(device);
+    }
+    sink.onSummary(summary);
+}
+
+void simulate(Span<ProcessSpec> processes, const PolicyConfig& config, MetricsSink& sink) {
+    reportRun(processes, runEngine(processes, config, sink.wantsSchedule()), sink, config.cpus.devices);
+}
@@ -0,0 +1,124 @@
+#ifndef SIMULATOR_H
+#define SIMULATOR_H
+
+#include <string>
+#include <vector>
+#include "engine.h"
+#include "workload.h"
+
+struct PolicyConfig {
+    Policy policy = POLICY_FIFO;
+    int quantum = 1;                // RR time quantum, CFS slice
+    MultiCpuConfig cpus;            // Simulated CPUs, host threads and balance interval
+};
+
+struct ProcessMetrics {
+    int process;                    // Index into the input
+    SimTime arrival;
+    SimTime totalCpuBurst;          // Over all threads
+    SimTime completion;
+    SimTime turnaround;
+    SimTime waiting;                // Turnaround time minus the CPU time of the longest thread
+};
+
+// Aggregate over every process in a group node and the nodes below it
+struct GroupMetrics {
+    std::string path;
+    int processes = 0;
+    SimTime cpuTime = 0;
+    double averageTurnaround = 0;
+    double averageWaiting = 0;
+    SimTime p95Turnaround = 0;
+    SimTime p99Turnaround = 0;
+    SimTime maxWaiting = 0;
+};
+
+struct DeviceMetrics {
+    int channels = 0;
+    long long requests = 0;
+    double utilisation = 0;         // Busy channel time over channels x makespan
+    double meanWait = 0;            // Queueing delay before service
+    SimTime waitP50 = 0;
+    SimTime waitP90 = 0;
+    SimTime waitP99 = 0;
+    SimTime waitMax = 0;
+};
+
+struct RunSummary {
+    int processes = 0;
+    SimTime makespan = 0;
+    double averageTurnaround = 0;
+    double averageWaiting = 0;
+    SimTime maxTurnaround = 0;
+    SimTime maxWaiting = 0;
+    long long migrations = 0;
+    long long contextSwitches = 0;
+    SimTime overhead = 0;           // Busy time spent on switch costs (see SwitchCosts)
+    std::vector<SimTime> busy;      // Busy time of every CPU
+    // Jobs with a deadline (see ProcessSpec::period); all zero without any
+    long long deadlineJobs = 0;
+    long long missedDeadlines = 0;
+    SimTime latenessP50 = 0;        // Lateness is completion minus deadline
+    SimTime latenessP90 = 0;
+    SimTime latenessP99 = 0;
+    SimTime latenessMax = 0;
+    double periodicDemand = 0;      // Sum over periodic processes of mean job length / period
+    std::vector<GroupMetrics> groups;   // Root first, when the workload has groups
+    std::vector<PolicySwitch> switches; // Discipline changes of the adaptive policy, CPU by CPU
+    std::vector<DeviceMetrics> devices; // One per configured I/O device
+    // Gang scheduling only: time covered by slots and the CPU time in them
+    // that no gang held or that a gang held while its thread could not run
+    SimTime slotTime = 0;
+    SimTime unallocated = 0;
+    SimTime stalled = 0;
+    int gangRows = 0;
+    SimTime telemetryWindow = 0;
+    std::vector<TelemetryWindow> telemetry;     // When the run had a telemetry window
+};
+
+// Receives the results of a run: the schedule CPU by CPU, then every
+// process in input order, then the summary. Override what you need.
+class MetricsSink {
+public:
+    virtual ~MetricsSink() = default;
+    // Returning false skips recording the schedule, which saves memory on long runs
+    virtual bool wantsSchedule() const { return true; }
+    virtual void onSegment(int /*cpu*/, const Segment& /*segment*/) {}
+    virtual void onProcess(const ProcessMetrics& /*metrics*/) {}
+    virtual void onSummary(const RunSummary& /*summary*/) {}
+};
+
+// Keeps everything in memory
+class CollectingSink : public MetricsSink {
+public:
+    explicit CollectingSink(bool recordSchedule = false) : recordSchedule(recordSchedule) {}
+
+    bool wantsSchedule() const override { return recordSchedule; }
+    void onSegment(int cpu, const Segment& segment) override;
+    void onProcess(const ProcessMetrics& metrics) override { processes.push_back(metrics); }
+    void onSummary(const RunSummary& result) override { summary = result; }
+
+    std::vector<std::vector<Segment>> schedule;
+    std::vector<ProcessMetrics> processes;
+    RunSummary summary;
+
+private:
+    bool recordSchedule;
+};
+
+// Throws std::invalid_argument for a bad configuration or malformed process
+void validateRun(Span<ProcessSpec> processes, const PolicyConfig& config);
+
+// Validate the configuration and run the engine
+MultiCpuResult runEngine(Span<ProcessSpec> processes, const PolicyConfig& config, bool recordSchedule);
+
+// Feed a finished run to a sink, deriving the per-process metrics and summary.
+// `devices` gives the channel counts behind the device utilisation.
+void reportRun(Span<ProcessSpec> processes, const MultiCpuResult& result, MetricsSink& sink,
+               const std::vector<DeviceConfig>& devices);
+
+// Simulate the workload under one policy. The bursts are read in place from
+// the caller's arrays. Throws std::invalid_argument for a bad configuration.
+void simulate(Span<ProcessSpec> processes, const PolicyConfig& config, MetricsSink& sink);
+
+#endif // SIMULATOR_H
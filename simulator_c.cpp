@@ -0,0 +1,73 @@
+#include "simulator_c.h"
+
+#include <exception>
+#include <stdexcept>
+#include "simulator.h"
+using namespace std;
+
+
+// Copies results straight into the caller's C arrays
+class CArraySink : public MetricsSink {
+public:
+    CArraySink(sched_process_metrics* metrics, sched_summary* summary) : metrics(metrics), summary(summary) {}
+
+    bool wantsSchedule() const override { return false; }
+
+    void onProcess(const ProcessMetrics& m) override {
+        if (metrics) {
+            metrics[m.process] = {m.completion, m.turnaround, m.waiting};
+        }
+    }
+
+    void onSummary(const RunSummary& s) override {
+        if (summary) {
+            *summary = {s.makespan, s.averageTurnaround, s.averageWaiting, s.maxTurnaround, s.maxWaiting, s.migrations};
+        }
+    }
+
+private:
+    sched_process_metrics* metrics;
+    sched_summary* summary;
+};
+
+extern "C" void sched_default_config(sched_config* config) {
+    MultiCpuConfig defaults;
+    config->algorithm = "FIFO";
+    config->quantum = 1;
+    config->cpus = defaults.cpus;
+    config->threads = defaults.threads;
+    config->balance_interval = defaults.balanceInterval;
+}
+
+extern "C" int sched_simulate(const sched_process* processes, size_t count, const sched_config* config,
+                              sched_process_metrics* metrics, sched_summary* summary) {
+    if ((!processes && count > 0) || !config || !config->algorithm) {
+        return SCHED_INVALID_ARGUMENT;
+    }
+    try {
+        PolicyConfig policy;
+        if (!parsePolicy(config->algorithm, policy.policy)) {
+            return SCHED_INVALID_ARGUMENT;
+        }
+        policy.quantum = config->quantum;
+        policy.cpus.cpus = config->cpus;
+        policy.cpus.threads = config->threads;
+        policy.cpus.balanceInterval = config->balance_interval;
+
+        // Views only; the bursts stay in the caller's arrays
+        vector<ProcessSpec> specs(count);
+        for (size_t i = 0; i < count; i++) {
+            specs[i].arrival = processes[i].arrival;
+            specs[i].cpuBursts = Span<int>(processes[i].cpu_bursts, processes[i].num_cpu_bursts);
+            specs[i].ioBursts = Span<int>(processes[i].io_bursts, processes[i].num_io_bursts);
+        }
+
+        CArraySink sink(metrics, summary);
+        simulate(specs, policy, sink);
+        return SCHED_OK;
+    } catch (const invalid_argument&) {
+        return SCHED_INVALID_ARGUMENT;
+    } catch (const exception&) {
+        return SCHED_INTERNAL_ERROR;
+    }
+}
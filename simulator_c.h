@@ -0,0 +1,61 @@
+#ifndef SIMULATOR_C_H
+#define SIMULATOR_C_H
+
+/* C interface to the scheduling simulator. Burst arrays are read in place. */
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    long long arrival;
+    const int* cpu_bursts;
+    size_t num_cpu_bursts;
+    const int* io_bursts;           /* io_bursts[i] follows cpu_bursts[i] */
+    size_t num_io_bursts;
+} sched_process;
+
+typedef struct {
+    const char* algorithm;          /* "FIFO", "SJF", "SRTF", "RR" or "CFS" */
+    int quantum;                    /* RR time quantum, CFS slice */
+    int cpus;
+    int threads;
+    long long balance_interval;
+} sched_config;
+
+typedef struct {
+    long long completion;
+    long long turnaround;
+    long long waiting;
+} sched_process_metrics;
+
+typedef struct {
+    long long makespan;
+    double average_turnaround;
+    double average_waiting;
+    long long max_turnaround;
+    long long max_waiting;
+    long long migrations;
+} sched_summary;
+
+enum {
+    SCHED_OK = 0,
+    SCHED_INVALID_ARGUMENT = 1,
+    SCHED_INTERNAL_ERROR = 2
+};
+
+/* Single CPU, FIFO, quantum 1 */
+void sched_default_config(sched_config* config);
+
+/* Run one simulation. `metrics` may be NULL, otherwise it receives `count`
+   entries in input order. `summary` may be NULL. Returns a SCHED_* code. */
+int sched_simulate(const sched_process* processes, size_t count, const sched_config* config,
+                   sched_process_metrics* metrics, sched_summary* summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SIMULATOR_C_H */
@@ -0,0 +1,103 @@
+#include "telemetry.h"
+
+#include <algorithm>
+using namespace std;
+
+
+void WindowSeries::grow(size_t windows) {
+    if (windows > busy.size()) {
+        busy.resize(windows, 0);
+        queued.resize(windows, 0);
+        blocked.resize(windows, 0);
+        completions.resize(windows, 0);
+        waiting.resize(windows, 0);
+    }
+}
+
+void WindowSeries::observe(SimTime now, int running, SimTime ready, SimTime io) {
+    if (now <= last) {
+        return;
+    }
+    SimTime from = last;
+    last = now;
+    if (running == 0 && ready == 0 && io == 0) {
+        return;  // Idle gaps leave the windows at zero
+    }
+    size_t w = from / width;
+    grow((now - 1) / width + 1);
+    while (from < now) {
+        SimTime end = min(now, (SimTime)(w + 1) * width);
+        busy[w] += running * (end - from);
+        queued[w] += ready * (end - from);
+        blocked[w] += io * (end - from);
+        from = end;
+        w++;
+    }
+}
+
+void WindowSeries::complete(SimTime time, SimTime wait) {
+    size_t w = time / width;
+    grow(w + 1);
+    completions[w]++;
+    waiting[w] += wait;
+}
+
+void WindowSeries::merge(const WindowSeries& other) {
+    width = other.width;
+    grow(other.windows());
+    for (size_t w = 0; w < other.windows(); w++) {
+        busy[w] += other.busy[w];
+        queued[w] += other.queued[w];
+        blocked[w] += other.blocked[w];
+        completions[w] += other.completions[w];
+        waiting[w] += other.waiting[w];
+    }
+}
+
+vector<TelemetryWindow> telemetryWindows(const WindowSeries& series, int cpus, SimTime end) {
+    vector<TelemetryWindow> windows;
+    if (series.width <= 0) {
+        return windows;
+    }
+    size_t count = max<size_t>(series.windows(), (end + series.width - 1) / series.width);
+    for (size_t w = 0; w < count; w++) {
+        TelemetryWindow window = {(SimTime)w * series.width, 0, 0, 0, 0, 0};
+        SimTime length = series.width;
+        if (end > window.start) {
+            length = min(length, end - window.start);
+        }
+        if (w < series.windows()) {
+            window.utilisation = (double)series.busy[w] / length / max(1, cpus);
+            window.queueLength = (double)series.queued[w] / length;
+            window.inIo = (double)series.blocked[w] / length;
+            window.completions = series.completions[w];
+            if (window.completions > 0) {
+                window.meanWait = (double)series.waiting[w] / window.completions;
+            }
+        }
+        windows.push_back(window);
+    }
+    return windows;
+}
+
+void writeTelemetryCsv(ostream& out, const vector<TelemetryWindow>& windows) {
+    out << "start,utilisation,ready,io,completions,mean_wait\n";
+    for (const TelemetryWindow& window : windows) {
+        out << window.start << ',' << window.utilisation << ',' << window.queueLength << ',' << window.inIo << ','
+            << window.completions << ',' << window.meanWait << '\n';
+    }
+}
+
+void writeTelemetryBinary(ostream& out, SimTime width, const vector<TelemetryWindow>& windows) {
+    static const char MAGIC[8] = {'S', 'C', 'H', 'E', 'D', 'T', 'M', '1'};
+    long long count = windows.size();
+    out.write(MAGIC, sizeof(MAGIC));
+    out.write((const char*)&width, sizeof(width));
+    out.write((const char*)&count, sizeof(count));
+    for (const TelemetryWindow& window : windows) {
+        const double rates[] = {window.utilisation, window.queueLength, window.inIo, window.meanWait};
+        out.write((const char*)&window.start, sizeof(window.start));
+        out.write((const char*)&window.completions, sizeof(window.completions));
+        out.write((const char*)rates, sizeof(rates));
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <ostream>
+#include <vector>
+#include "workload.h"
+
+// Time-weighted state of a CPU, window by window. The engine reports the
+// state that held since its previous event at every event, so an event
+// costs O(1) plus one step per window boundary crossed while anything was
+// running, queued or in I/O. Series of several CPUs add up with merge().
+struct WindowSeries {
+    SimTime width = 0;                  // 0 when off
+    SimTime last = 0;                   // Observed up to here
+    std::vector<SimTime> busy;          // CPU time used in each window
+    std::vector<SimTime> queued;        // Ready-queue length integrated over each window
+    std::vector<SimTime> blocked;       // Processes in I/O, integrated likewise
+    std::vector<long long> completions;
+    std::vector<SimTime> waiting;       // Summed waiting time of those completions
+
+    // The CPU had `running` (0 or 1), `ready` and `io` from `last` until `now`
+    void observe(SimTime now, int running, SimTime ready, SimTime io);
+    void complete(SimTime time, SimTime wait);
+    void merge(const WindowSeries& other);
+    size_t windows() const { return busy.size(); }
+
+private:
+    void grow(size_t windows);
+};
+
+struct TelemetryWindow {
+    SimTime start;
+    double utilisation;             // Busy share of all CPUs
+    double queueLength;             // Mean ready tasks, all CPUs
+    double inIo;                    // Mean tasks in I/O
+    long long completions;
+    double meanWait;                // Of the completions, 0 without any
+};
+
+// The windows up to `end`, usually the makespan; the last one may be
+// shorter than the others and its rates are over its own length
+std::vector<TelemetryWindow> telemetryWindows(const WindowSeries& series, int cpus, SimTime end);
+
+// One line per window after a header line
+void writeTelemetryCsv(std::ostream& out, const std::vector<TelemetryWindow>& windows);
+
+// "SCHEDTM1", the window width and the window count as int64, then per
+// window its start and completions as int64 and utilisation, queue length,
+// tasks in I/O and mean wait as float64, all in host byte order
+void writeTelemetryBinary(std::ostream& out, SimTime width, const std::vector<TelemetryWindow>& windows);
+
+#endif // TELEMETRY_H
@@ -0,0 +1,77 @@
+/* Test plugin whose pick_next() never names a queued task, so the engine
+   always falls back to the longest-queued one. It keeps its own copy of the
+   queue and aborts if the engine's and its own ever disagree: a dequeue()
+   of a task it does not hold, or an enqueue() of one it still holds. With
+   the fallback reported through dequeue(), it runs like the built-in FIFO
+   on one CPU. */
+
+#include <stdlib.h>
+#include "sched_plugin.h"
+
+typedef struct {
+    char* queued;                   /* By task id */
+    size_t capacity;
+} badpick_state;
+
+static void* badpick_create(int quantum) {
+    (void)quantum;
+    return calloc(1, sizeof(badpick_state));
+}
+
+static void badpick_destroy(void* state) {
+    badpick_state* s = state;
+    free(s->queued);
+    free(s);
+}
+
+static int badpick_enqueue(void* state, long long now, const sched_task* tasks, size_t count) {
+    badpick_state* s = state;
+    (void)now;
+    for (size_t k = 0; k < count; k++) {
+        size_t id = tasks[k].id;
+        if (id >= s->capacity) {
+            size_t capacity = 2 * id + 64;
+            char* queued = realloc(s->queued, capacity);
+            if (!queued) {
+                abort();
+            }
+            for (size_t i = s->capacity; i < capacity; i++) {
+                queued[i] = 0;
+            }
+            s->queued = queued;
+            s->capacity = capacity;
+        }
+        if (s->queued[id]) {
+            abort();
+        }
+        s->queued[id] = 1;
+    }
+    return 0;
+}
+
+static void badpick_dequeue(void* state, long long now, const int* ids, size_t count) {
+    badpick_state* s = state;
+    (void)now;
+    for (size_t k = 0; k < count; k++) {
+        if ((size_t)ids[k] >= s->capacity || !s->queued[ids[k]]) {
+            abort();
+        }
+        s->queued[ids[k]] = 0;
+    }
+}
+
+static int badpick_pick_next(void* state, long long now, long long* slice) {
+    (void)state;
+    (void)now;
+    (void)slice;
+    return -7;
+}
+
+static const sched_plugin plugin = {
+    SCHED_PLUGIN_ABI_VERSION, "bogus-pick test plugin",
+    badpick_create, badpick_destroy, badpick_enqueue, NULL, badpick_dequeue, badpick_pick_next, NULL
+};
+
+const sched_plugin* sched_policy_plugin(void) {
+    return &plugin;
+}
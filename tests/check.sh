@@ -0,0 +1,278 @@
+#!/bin/sh
+# Equivalence checks between run modes that must agree exactly, over random
+# workloads from genworkload. Run through "make check".
+cd "$(dirname "$0")/.." || exit 1
+
+MAIN=./main
+GEN=./tests/genworkload
+SEEDS="1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25 26 27 28 29 30"
+POLICIES="FIFO SJF SRTF RR CFS EDF ADAPTIVE"
+# Modes that take the whole workload up front also run RM
+BATCH_POLICIES="$POLICIES RM"
+QUANTUM=4
+WORK=$(mktemp -d) || exit 1
+trap 'rm -rf "$WORK"' EXIT
+failures=0
+
+fail() {
+    echo "FAIL: $*"
+    failures=$((failures + 1))
+}
+
+# Completion time of every process, from the table of a normal run
+completions() {
+    awk -F'\t+' '/^P[0-9]/ { print substr($1, 2), $4 }'
+}
+
+# ATAT, AWT, makespan and the largest turnaround and waiting time of a
+# normal run, in the order a cluster summary prints them
+batchSummary() {
+    awk -F'\t+' '/^P[0-9]/ { if ($5 > tat) tat = $5; if ($6 > wt) wt = $6 }
+        /^Average/ { sub(/.*: /, ""); print }
+        /^Makespan/ { sub(/.*: /, ""); makespan = $0 }
+        END { print tat; print wt; print makespan }'
+}
+
+clusterSummary() {
+    awk '/^Average|^Max Waiting|^Makespan/ { sub(/.*: /, ""); print }
+        /^Turnaround/ { sub(/.*\//, ""); print }'
+}
+
+for seed in $SEEDS; do
+    $GEN "$seed" 60 > "$WORK/plain.dat"
+    for policy in $POLICIES; do
+        $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --no-cache > "$WORK/batch.txt"
+
+        # Online mode decides the same schedule as a normal run
+        $MAIN "$policy" $QUANTUM --online < "$WORK/plain.dat" |
+            awk '$2 == "exit" { print $3, $1 }' | sort -n > "$WORK/online.txt"
+        completions < "$WORK/batch.txt" | sort -n > "$WORK/expected.txt"
+        cmp -s "$WORK/online.txt" "$WORK/expected.txt" || fail "online $policy seed $seed"
+
+        # A one-server cluster is a single-CPU run
+        $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cluster=1 | clusterSummary > "$WORK/cluster.txt"
+        batchSummary < "$WORK/batch.txt" > "$WORK/expected.txt"
+        cmp -s "$WORK/cluster.txt" "$WORK/expected.txt" || fail "cluster $policy seed $seed"
+
+        # The result cache replays what it stored: a miss, then a hit
+        for pass in miss hit; do
+            $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cache-dir="$WORK/cache" > "$WORK/cached.txt"
+            cmp -s "$WORK/cached.txt" "$WORK/batch.txt" || fail "cache $pass $policy seed $seed"
+        done
+
+        # Pipelined mode prints exactly what a normal run does
+        $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --pipeline > "$WORK/pipeline.txt"
+        cmp -s "$WORK/pipeline.txt" "$WORK/batch.txt" || fail "pipeline $policy seed $seed"
+    done
+
+    # What-if diff: double the first burst of process 50 and append a process
+    awk 'NR == 50 { $2 = $2 * 2; print 50, $0 } END { print NR + 1, $1, 7, 3, 5, -1 }' \
+        "$WORK/plain.dat" > "$WORK/diff.txt"
+    awk 'NR == 50 { $2 = $2 * 2 } { print } END { print $1, 7, 3, 5, -1 }' \
+        "$WORK/plain.dat" > "$WORK/changed.dat"
+    $GEN "$seed" 60 rle > "$WORK/rle.dat"
+    $GEN "$seed" 60 expanded > "$WORK/expanded.dat"
+    # Every third process periodic, with a deadline inside the period
+    awk 'NR % 3 == 0 { $0 = $0 " period=40 deadline=30" } { print }' "$WORK/plain.dat" > "$WORK/realtime.dat"
+    # Two CFS groups of different weight, one with weighted processes
+    awk '{ print $0 (NR % 2 ? " group=/a:300" : " group=/b weight=50") }' "$WORK/plain.dat" > "$WORK/groups.dat"
+    # I/O spread over two devices
+    awk '{ print $0 " device=" NR % 2 }' "$WORK/plain.dat" > "$WORK/devices.dat"
+
+    for policy in $BATCH_POLICIES; do
+        # Multi-CPU output does not depend on the number of host threads
+        $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cpus=3 --no-cache > "$WORK/batch.txt"
+        $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cpus=3 --threads=3 --no-cache > "$WORK/threads.txt"
+        cmp -s "$WORK/threads.txt" "$WORK/batch.txt" || fail "threads $policy seed $seed"
+
+        # Windows derived from the CPUs' next events balance wherever a
+        # balancing point at every time unit would
+        $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cpus=3 --balance=1 --no-cache > "$WORK/expected.txt"
+        cmp -s "$WORK/batch.txt" "$WORK/expected.txt" || fail "balance $policy seed $seed"
+        $MAIN "$policy" "$WORK/devices.dat" $QUANTUM --cpus=3 --devices=1,2:SSTF --no-cache > "$WORK/windows.txt"
+        $MAIN "$policy" "$WORK/devices.dat" $QUANTUM --cpus=3 --devices=1,2:SSTF --balance=1 --no-cache > "$WORK/expected.txt"
+        cmp -s "$WORK/windows.txt" "$WORK/expected.txt" || fail "balance devices $policy seed $seed"
+
+        # Replicas without jitter are the plain run
+        for workload in realtime groups; do
+            $MAIN "$policy" "$WORK/$workload.dat" $QUANTUM --replicas=2 --jitter=uniform:0 |
+                awk -F'\t+' -v policy="$policy" '$1 == policy { print $2; print $4 }' > "$WORK/replicas.txt"
+            $MAIN "$policy" "$WORK/$workload.dat" $QUANTUM --no-cache |
+                awk '/^Average/ { print $NF }' > "$WORK/expected.txt"
+            cmp -s "$WORK/replicas.txt" "$WORK/expected.txt" || fail "replicas $workload $policy seed $seed"
+        done
+
+        # Devices with a channel for every request are unbounded I/O; the
+        # device table and the blank line before it are dropped
+        for cpus in 1 3; do
+            $MAIN "$policy" "$WORK/devices.dat" $QUANTUM --cpus=$cpus --devices=1000,1000:SSTF --no-cache |
+                awk '/^Device\t/ { table = 1; blank = 0; next }
+                    table && /^[0-9]/ { next }
+                    { table = 0 }
+                    /^$/ { if (blank) print ""; blank = 1; next }
+                    { if (blank) print ""; blank = 0; print }
+                    END { if (blank) print "" }' > "$WORK/devices.txt"
+            $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cpus=$cpus --no-cache > "$WORK/expected.txt"
+            cmp -s "$WORK/devices.txt" "$WORK/expected.txt" || fail "unbounded devices $policy cpus $cpus seed $seed"
+        done
+
+        for cpus in 1 2; do
+            # A what-if run resumed from a checkpoint equals a full run of
+            # the changed workload; the header and resume line are dropped
+            $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cpus=$cpus --what-if="$WORK/diff.txt" --checkpoint=20 |
+                sed '1d' | sed '$d' | sed '$d' > "$WORK/whatif.txt"
+            $MAIN "$policy" "$WORK/changed.dat" $QUANTUM --cpus=$cpus --no-cache > "$WORK/expected.txt"
+            cmp -s "$WORK/whatif.txt" "$WORK/expected.txt" || fail "what-if $policy cpus $cpus seed $seed"
+
+            # Repeat groups run like the bursts written out
+            $MAIN "$policy" "$WORK/rle.dat" $QUANTUM --cpus=$cpus --no-cache > "$WORK/rle.txt"
+            $MAIN "$policy" "$WORK/expanded.dat" $QUANTUM --cpus=$cpus --no-cache > "$WORK/expected.txt"
+            cmp -s "$WORK/rle.txt" "$WORK/expected.txt" || fail "repeat groups $policy cpus $cpus seed $seed"
+        done
+    done
+done
+
+# Every option that changes the result is in the cache key: runs that differ
+# in one of them share a cache but never replay each other's entry
+for seed in 1 2 3 4 5; do
+    $GEN "$seed" 60 > "$WORK/plain.dat"
+    awk '{ print $0 " device=0" }' "$WORK/plain.dat" > "$WORK/devices.dat"
+    awk 'NR == 30 { $1 = $1 + 1 } { print }' "$WORK/plain.dat" > "$WORK/changed.dat"
+    for policy in RR CFS; do
+        for run in "plain.dat 4" "plain.dat 8" "plain.dat 4 --cpus=2" "plain.dat 4 --cpus=2 --balance=5" \
+            "plain.dat 4 --switch-cost=1" "plain.dat 4 --cold-cost=2" "devices.dat 4 --devices=2" \
+            "devices.dat 4 --devices=1" "devices.dat 4 --devices=1:SSTF" "changed.dat 4"; do
+            set -- $run
+            file=$1
+            shift
+            $MAIN "$policy" "$WORK/$file" "$@" --cache-dir="$WORK/keys" > "$WORK/cached.txt"
+            $MAIN "$policy" "$WORK/$file" "$@" --no-cache > "$WORK/expected.txt"
+            cmp -s "$WORK/cached.txt" "$WORK/expected.txt" || fail "cache key $policy $run seed $seed"
+        done
+    done
+done
+
+# Switch costs on workloads small enough to schedule by hand: the makespan,
+# context switches and overhead each run must report
+costs() {
+    printf "$3" > "$WORK/costs.dat"
+    $MAIN "$1" "$WORK/costs.dat" $QUANTUM $2 --no-cache |
+        awk '/^Makespan|^Context switches|^Switch overhead/ { sub(/^[^:]*: /, ""); sub(/ .*/, ""); found = found sep $0; sep = " " }
+            END { print found }' > "$WORK/costs.txt"
+    echo "$4" | cmp -s "$WORK/costs.txt" - || fail "costs $1 $2"
+}
+# Three FIFO runs of 5, each paying 2 to switch in
+costs FIFO --switch-cost=2 '0 5 -1\n0 5 -1\n0 5 -1\n' "21 3 6"
+# Two RR processes of 6 in quanta of 4 switch four times
+costs RR --switch-cost=1 '0 6 -1\n0 6 -1\n' "16 4 4"
+# The second burst pays for the cache lost during the I/O
+costs FIFO --cold-cost=2 '0 3 5 3 -1\n' "13 1 2"
+# The arrival at 1 preempts the first switch after 1 of its 3 units
+costs SRTF --switch-cost=3 '0 10 -1\n1 1 -1\n' "18 3 7"
+
+# Device queues on one channel: requests of 10, 5 and 1 issued at 1, 2 and 3
+# leave the channel in issue order (FIFO, or DEADLINE once the two waiting
+# requests have expired) or shortest first (SSTF, or DEADLINE before that)
+printf '0 1 10 1 -1 device=0\n0 1 5 1 -1 device=0\n0 1 1 1 -1 device=0\n' > "$WORK/io.dat"
+for run in "1 12 17 18" "1:SSTF 12 18 13" "1:DEADLINE:9 12 17 18" "1:DEADLINE:10 12 18 13"; do
+    set -- $run
+    $MAIN FIFO "$WORK/io.dat" --devices=$1 --no-cache |
+        awk -F'\t+' '/^P[0-9]/ { found = found sep $4; sep = " " } END { print found }' > "$WORK/io.txt"
+    shift
+    echo "$*" | cmp -s "$WORK/io.txt" - || fail "device order $run"
+done
+
+# Gang placement worked out by hand: the completion of every process, then
+# the makespan, fragmentation and stalls
+gang() {
+    printf "$2" > "$WORK/gang.dat"
+    $MAIN RR "$WORK/gang.dat" $QUANTUM --cpus=$1 --gang --no-cache |
+        awk -F'\t+' '/^P[0-9]/ { found = found sep $4; sep = " " }
+            /^Makespan|^Fragmentation|^Gang stalls/ { sub(/^[^:]*: /, ""); sub(/ .*/, ""); found = found sep $0 }
+            END { print found }' > "$WORK/gang.txt"
+    echo "$3" | cmp -s "$WORK/gang.txt" - || fail "gang cpus $1 $2"
+}
+# The pairs fill rows 0 and 1, and the singles take the last column of each:
+# row 0 leaves a column free once its single is done, row 1 two columns
+gang 3 '0 8 -1 threads=2\n0 4 -1 threads=2\n0 4 -1\n0 8 -1\n' "12 8 4 16 16 12 0"
+# The pair fills row 0 and the single leaves a column of row 1 free; the
+# finished short thread holds its column through the pair's second turn
+gang 2 '0 8 | 4 -1\n0 4 -1\n' "12 8 12 4 4"
+
+# Telemetry rows worked out by hand; the last window ends with the run
+telemetry() {
+    printf "$3" > "$WORK/telemetry.dat"
+    $MAIN FIFO "$WORK/telemetry.dat" --cpus=$1 --telemetry=$2 --telemetry-out="$WORK/telemetry.csv" --no-cache > /dev/null
+    printf "start,utilisation,ready,io,completions,mean_wait\n$4" | cmp -s "$WORK/telemetry.csv" - ||
+        fail "telemetry cpus $1 $3"
+}
+# One process waits 4 for the other
+telemetry 1 5 '0 4 -1\n0 4 -1\n' '0,1,0.8,0,1,0\n5,1,0,0,1,4\n'
+# Process 1 blocks from 2 to 8 while process 2 runs from 1 to 4 on CPU 2
+telemetry 2 4 '0 2 6 2 -1\n1 3 -1\n' '0,0.625,0,0.5,0,0\n4,0,0,1,1,0\n8,0.5,0,0,1,6\n'
+
+# Telemetry does not depend on the host threads, and a cache hit writes it
+# again
+for seed in 1 2 3 4 5; do
+    $GEN "$seed" 60 > "$WORK/plain.dat"
+    for policy in $BATCH_POLICIES; do
+        $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cpus=3 --telemetry=25 --telemetry-out="$WORK/expected.csv" \
+            --no-cache > /dev/null
+        for run in "--threads=3 --no-cache" "--cache-dir=$WORK/telemetry" "--cache-dir=$WORK/telemetry"; do
+            rm -f "$WORK/telemetry.csv"
+            $MAIN "$policy" "$WORK/plain.dat" $QUANTUM --cpus=3 --telemetry=25 --telemetry-out="$WORK/telemetry.csv" \
+                $run > /dev/null
+            cmp -s "$WORK/telemetry.csv" "$WORK/expected.csv" || fail "telemetry $policy $run seed $seed"
+        done
+    done
+done
+
+# Trace import: the same schedule as recorded by trace-cmd and by perf sched
+# gives the workload in tests/trace.dat, and simulating a trace directly
+# runs that workload. Task b runs 10 units, is preempted, runs 5 more and
+# exits; task a alternates 10 units of CPU and 20 of sleep
+for trace in trace-cmd perf-sched; do
+    $MAIN --import="tests/$trace.txt" 2> /dev/null > "$WORK/imported.dat"
+    cmp -s "$WORK/imported.dat" tests/trace.dat || fail "import $trace"
+    for policy in $BATCH_POLICIES; do
+        $MAIN "$policy" "tests/$trace.txt" $QUANTUM --trace --no-cache > "$WORK/traced.txt"
+        $MAIN "$policy" tests/trace.dat $QUANTUM --no-cache > "$WORK/expected.txt"
+        cmp -s "$WORK/traced.txt" "$WORK/expected.txt" || fail "trace $trace $policy"
+    done
+done
+
+# A plugin whose picks are never queued runs the longest-queued task, which
+# makes it FIFO on one CPU; it aborts if its queue and the engine's diverge
+for seed in $SEEDS; do
+    $GEN "$seed" 60 > "$WORK/plain.dat"
+    $MAIN PLUGIN "$WORK/plain.dat" --plugin=tests/badpick.so > "$WORK/plugin.txt" ||
+        fail "bogus pick seed $seed"
+    $MAIN FIFO "$WORK/plain.dat" --no-cache > "$WORK/expected.txt"
+    cmp -s "$WORK/plugin.txt" "$WORK/expected.txt" || fail "bogus pick against FIFO seed $seed"
+    $MAIN PLUGIN "$WORK/plain.dat" --cpus=3 --plugin=tests/badpick.so > /dev/null ||
+        fail "bogus pick cpus 3 seed $seed"
+
+    # The bundled examples reproduce the built-in policies on one CPU: SJF
+    # exactly, RR in its metrics, since it merges slices nobody waits for
+    $MAIN PLUGIN "$WORK/plain.dat" $QUANTUM --plugin=plugins/sjf.so > "$WORK/plugin.txt"
+    $MAIN SJF "$WORK/plain.dat" $QUANTUM --no-cache > "$WORK/expected.txt"
+    cmp -s "$WORK/plugin.txt" "$WORK/expected.txt" || fail "sjf plugin seed $seed"
+    $MAIN PLUGIN "$WORK/plain.dat" $QUANTUM --plugin=plugins/rr.so | sed -n '/^Process\t/,$p' > "$WORK/plugin.txt"
+    $MAIN RR "$WORK/plain.dat" $QUANTUM --no-cache | sed -n '/^Process\t/,$p' > "$WORK/expected.txt"
+    cmp -s "$WORK/plugin.txt" "$WORK/expected.txt" || fail "rr plugin seed $seed"
+done
+
+# Nearest-rank percentiles on values whose ranks are known: turnarounds 1 to
+# 20 and lateness 0 to 9 of unit bursts run back to back
+awk 'BEGIN { for (i = 0; i < 20; i++) print "0 1 -1 group=/a" }' > "$WORK/group.dat"
+$MAIN FIFO "$WORK/group.dat" --no-cache | awk -F'\t+' '$1 == "/a" { print $6, $7 }' > "$WORK/percentiles.txt"
+echo "19 20" | cmp -s "$WORK/percentiles.txt" - || fail "group percentiles"
+awk 'BEGIN { for (i = 0; i < 10; i++) print "0 1 -1 deadline=1" }' > "$WORK/lateness.dat"
+$MAIN FIFO "$WORK/lateness.dat" --no-cache | sed -n 's/^Lateness p50\/p90\/p99\/max: //p' > "$WORK/percentiles.txt"
+echo "4/8/9/9" | cmp -s "$WORK/percentiles.txt" - || fail "lateness percentiles"
+
+if [ $failures -gt 0 ]; then
+    echo "$failures checks failed"
+    exit 1
+fi
+echo "All checks passed"
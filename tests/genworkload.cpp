@@ -0,0 +1,48 @@
+// Random workload for the equivalence checks in check.sh:
+//   genworkload <seed> <processes> [plain|rle|expanded]
+// "rle" writes some bursts as repeat groups and "expanded" writes the same
+// workload with every group spelled out. Arrivals are sorted, and the output
+// only depends on the seed.
+#include <cstdlib>
+#include <iostream>
+#include <random>
+#include <string>
+using namespace std;
+
+
+int main(int argc, char* argv[]) {
+    if (argc < 3) {
+        cerr << "Usage: " << argv[0] << " <seed> <processes> [plain|rle|expanded]" << endl;
+        return 1;
+    }
+    mt19937 rng(atoi(argv[1]));
+    int count = atoi(argv[2]);
+    string mode = argc > 3 ? argv[3] : "plain";
+    auto draw = [&](int low, int high) { return low + (int)(rng() % (high - low + 1)); };
+
+    int arrival = 0;
+    for (int i = 0; i < count; i++) {
+        arrival += draw(0, 5);
+        cout << arrival;
+        if (mode != "plain") {
+            // A repeated (CPU, I/O) pair before the plain bursts
+            int cpu = draw(1, 12), io = draw(1, 8), times = draw(1, 6);
+            if (mode == "rle") {
+                cout << " (" << cpu << ' ' << io << ")x" << times;
+            } else {
+                for (int k = 0; k < times; k++) {
+                    cout << ' ' << cpu << ' ' << io;
+                }
+            }
+        }
+        int bursts = draw(1, 4);
+        for (int j = 0; j < bursts; j++) {
+            cout << ' ' << draw(1, 12);
+            if (j + 1 < bursts) {
+                cout << ' ' << draw(1, 8);
+            }
+        }
+        cout << " -1\n";
+    }
+    return 0;
+}
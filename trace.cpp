@@ -0,0 +1,320 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+using namespace std;
+
+
+// "12345.678901:" to nanoseconds; false if the token is not a timestamp
+static bool parseTimestamp(const string& token, long long& nanoseconds) {
+    size_t dot = token.find('.');
+    if (dot == string::npos || dot == 0) {
+        return false;
+    }
+    long long seconds = 0, fraction = 0;
+    int digits = 0;
+    for (size_t i = 0; i < dot; i++) {
+        if (!isdigit((unsigned char)token[i])) {
+            return false;
+        }
+        seconds = seconds * 10 + (token[i] - '0');
+    }
+    size_t i = dot + 1;
+    for (; i < token.size() && isdigit((unsigned char)token[i]); i++) {
+        if (digits < 9) {
+            fraction = fraction * 10 + (token[i] - '0');
+            digits++;
+        }
+    }
+    if (digits == 0 || (i < token.size() && token[i] != ':')) {
+        return false;
+    }
+    for (; digits < 9; digits++) {
+        fraction *= 10;
+    }
+    nanoseconds = seconds * 1000000000LL + fraction;
+    return true;
+}
+
+// Value of "name=value" up to the next space, empty if absent
+static string fieldValue(const string& text, const char* name) {
+    size_t pos = 0;
+    size_t length = strlen(name);
+    while ((pos = text.find(name, pos)) != string::npos) {
+        if (pos == 0 || text[pos - 1] == ' ') {
+            size_t begin = pos + length;
+            return text.substr(begin, text.find(' ', begin) - begin);
+        }
+        pos += length;
+    }
+    return "";
+}
+
+// Pid of an older-style "comm:pid [prio]" field; -1 if malformed
+static int bracketedPid(const string& text) {
+    size_t bracket = text.find(" [");
+    size_t colon = text.rfind(':', bracket);
+    if (bracket == string::npos || colon == string::npos) {
+        return -1;
+    }
+    char* end;
+    long pid = strtol(text.c_str() + colon + 1, &end, 10);
+    return end == text.c_str() + bracket ? (int)pid : -1;
+}
+
+static int parsePid(const string& value) {
+    char* end;
+    long pid = strtol(value.c_str(), &end, 10);
+    return value.empty() || *end ? -1 : (int)pid;
+}
+
+TraceImporter::TraceImporter(const TraceConfig& config) : config(config) {
+    this->config.resolution = max(1LL, config.resolution);
+}
+
+bool TraceImporter::addLine(const string& line) {
+    counts.lines++;
+    bool isSwitch = true;
+    size_t event = line.find("sched_switch:");
+    if (event == string::npos) {
+        isSwitch = false;
+        event = line.find("sched_wakeup");
+        if (event == string::npos) {
+            return false;
+        }
+    }
+    size_t fields = line.find(':', event);
+    if (fields == string::npos) {
+        return false;
+    }
+    string rest = line.substr(fields + 1);
+
+    // The timestamp is the token before the event name ("sched:" for perf)
+    size_t nameStart = line.rfind(' ', event);
+    if (nameStart == string::npos) {
+        return false;
+    }
+    size_t stampEnd = line.find_last_not_of(' ', nameStart);
+    if (stampEnd == string::npos) {
+        return false;
+    }
+    size_t stampStart = line.rfind(' ', stampEnd);
+    stampStart = stampStart == string::npos ? 0 : stampStart + 1;
+    long long now;
+    if (!parseTimestamp(line.substr(stampStart, stampEnd + 1 - stampStart), now)) {
+        return false;
+    }
+    if (start < 0) {
+        start = now;
+    }
+    now = max(now, last);   // Tolerate small reorderings between CPUs
+    last = now;
+
+    if (isSwitch) {
+        int prev, next;
+        string prevState;
+        size_t arrow = rest.find("==>");
+        if (rest.find("prev_pid=") != string::npos) {
+            prev = parsePid(fieldValue(rest, "prev_pid="));
+            next = parsePid(fieldValue(rest, "next_pid="));
+            prevState = fieldValue(rest, "prev_state=");
+        } else if (arrow != string::npos) {
+            string left = rest.substr(0, arrow);
+            prev = bracketedPid(left);
+            next = bracketedPid(rest.substr(arrow + 3));
+            size_t close = left.find(']');
+            size_t stateStart = close == string::npos ? string::npos : left.find_first_not_of(' ', close + 1);
+            if (stateStart != string::npos) {
+                prevState = left.substr(stateStart, left.find(' ', stateStart) - stateStart);
+            }
+        } else {
+            return false;
+        }
+        if (prev < 0 || next < 0 || prevState.empty()) {
+            return false;
+        }
+        if (prev != 0) {
+            switchOut(prev, prevState, now);
+        }
+        if (next != 0) {
+            switchIn(next, now);
+        }
+    } else {
+        int pid = rest.find(" pid=") != string::npos ? parsePid(fieldValue(rest, "pid=")) : bracketedPid(rest);
+        if (pid < 0) {
+            return false;
+        }
+        if (pid != 0) {
+            wake(pid, now);
+        }
+    }
+    counts.events++;
+    return true;
+}
+
+// Length of a burst in simulator units, at least 1
+int TraceImporter::units(long long nanoseconds) const {
+    long long value = (nanoseconds + config.resolution / 2) / config.resolution;
+    return (int)min<long long>(INT_MAX, max(1LL, value));
+}
+
+// Time since the start of the trace, in simulator units
+int TraceImporter::arrivalTime(long long now) const {
+    return (int)min<long long>(INT_MAX, (now - start + config.resolution / 2) / config.resolution);
+}
+
+// Task `pid`, created in `state` and arriving at `arrival` if it is new
+TraceImporter::TraceTask& TraceImporter::task(int pid, long long arrival, TaskState state) {
+    auto found = tasks.find(pid);
+    if (found != tasks.end()) {
+        return found->second;
+    }
+    counts.tasks++;
+    TraceTask& t = tasks[pid];
+    t.process.arrivalTime = arrivalTime(arrival);
+    t.state = state;
+    t.since = arrival;
+    return t;
+}
+
+// Bursts alternate CPU, I/O, CPU... A (CPU, I/O) pair is only stored once
+// the next CPU burst shows that the process went on, so a trailing I/O
+// burst is never kept. A pair equal to the previous one extends its run.
+void TraceImporter::addBurst(TraceTask& t, long long nanoseconds) {
+    Process& p = t.process;
+    if (t.pendingCpu < 0) {
+        t.pendingCpu = units(nanoseconds);
+        return;
+    }
+    if (t.pendingIo < 0) {
+        t.pendingIo = units(nanoseconds);
+        return;
+    }
+    int cpu = t.pendingCpu, io = t.pendingIo;
+    t.pendingCpu = units(nanoseconds);
+    t.pendingIo = -1;
+    if (!p.runs.empty()) {
+        BurstRun& run = p.runs.back();
+        if (run.length == 2 && p.tokens[run.start] == cpu && p.tokens[run.start + 1] == io && run.repeat < INT_MAX) {
+            run.repeat++;
+            return;
+        }
+    }
+    p.runs.push_back({(int)p.tokens.size(), 2, 1});
+    p.tokens.push_back(cpu);
+    p.tokens.push_back(io);
+}
+
+void TraceImporter::emit(TraceTask& t) {
+    Process& p = t.process;
+    if (t.pendingCpu >= 0) {
+        p.runs.push_back({(int)p.tokens.size(), 1, 1});
+        p.tokens.push_back(t.pendingCpu);
+    }
+    if (p.runs.empty()) {
+        counts.dropped++;
+    } else {
+        ready.push_back(move(p));
+        counts.processes++;
+    }
+    p = Process();
+    t.pendingCpu = -1;
+    t.pendingIo = -1;
+}
+
+void TraceImporter::wake(int pid, long long now) {
+    TraceTask& t = task(pid, now, TASK_RUNNABLE);
+    if (t.state != TASK_BLOCKED) {
+        return;  // New, or already runnable
+    }
+    if (t.split) {
+        t.process.arrivalTime = arrivalTime(now);
+        t.split = false;
+    } else {
+        addBurst(t, now - t.since);
+    }
+    t.state = TASK_RUNNABLE;
+    t.since = now;
+}
+
+void TraceImporter::switchOut(int pid, const string& state, long long now) {
+    // A task running when the trace started has run since then
+    TraceTask& t = task(pid, start, TASK_RUNNING);
+    if (t.state == TASK_RUNNING) {
+        t.ran += now - t.since;
+    }
+    t.since = now;
+    if (state[0] == 'R') {
+        t.state = TASK_RUNNABLE;  // Preempted: the burst goes on
+        return;
+    }
+    addBurst(t, t.ran);
+    t.ran = 0;
+    if (state[0] == 'X' || state[0] == 'Z' || state[0] == 'x') {
+        emit(t);
+        tasks.erase(pid);
+        return;
+    }
+    t.state = TASK_BLOCKED;
+    if ((int)t.process.tokens.size() >= config.maxTokens) {
+        emit(t);
+        t.split = true;
+    }
+}
+
+void TraceImporter::switchIn(int pid, long long now) {
+    TraceTask& t = task(pid, now, TASK_RUNNABLE);
+    if (t.state == TASK_BLOCKED) {
+        wake(pid, now);  // The wakeup was not traced
+    }
+    t.state = TASK_RUNNING;
+    t.since = now;
+}
+
+void TraceImporter::finish() {
+    vector<int> pids;
+    for (const auto& entry : tasks) {
+        pids.push_back(entry.first);
+    }
+    sort(pids.begin(), pids.end());
+    for (int pid : pids) {
+        TraceTask& t = tasks[pid];
+        if (t.state == TASK_RUNNING) {
+            t.ran += last - t.since;
+        }
+        if (t.state != TASK_BLOCKED && t.ran > 0) {
+            addBurst(t, t.ran);
+        }
+        if (t.state != TASK_BLOCKED || !t.split) {
+            emit(t);
+        }
+    }
+    tasks.clear();
+}
+
+size_t TraceImporter::drainProcesses(vector<Process>& out) {
+    size_t count = ready.size();
+    for (Process& p : ready) {
+        out.push_back(move(p));
+    }
+    ready.clear();
+    return count;
+}
+
+vector<Process> readTraceFile(const string& filePath, const TraceConfig& config) {
+    ifstream infile(filePath);
+    TraceImporter importer(config);
+    vector<Process> processes;
+    string line;
+    while (getline(infile, line)) {
+        importer.addLine(line);
+        importer.drainProcesses(processes);
+    }
+    importer.finish();
+    importer.drainProcesses(processes);
+    return processes;
+}
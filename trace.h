@@ -0,0 +1,83 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "workload.h"
+
+struct TraceConfig {
+    long long resolution = 1000;    // Nanoseconds per simulator time unit (microseconds)
+    int maxTokens = 4096;           // Burst tokens buffered per task before it is split off
+};
+
+struct TraceStats {
+    long long lines = 0;
+    long long events = 0;           // sched_switch and sched_wakeup lines understood
+    long long tasks = 0;            // Distinct pids seen, idle excluded
+    long long processes = 0;        // Processes emitted; long-lived tasks may give several
+    long long dropped = 0;          // Tasks that never ran inside the trace
+};
+
+// Rebuilds processes from the text of `trace-cmd report` or `perf sched
+// script`, in either the "prev_pid=..." or the older "comm:pid [prio]"
+// field layout. Every pid becomes a process that arrives when it is first
+// seen. Time on a CPU until the task blocks is one CPU burst (preemptions
+// only pause it), and the time until its next wakeup is the I/O burst.
+//
+// Lines are consumed one at a time in a single pass. A task is emitted as
+// soon as it exits, and consecutive identical (CPU, I/O) pairs are kept as
+// repeat groups. A task that buffers `maxTokens` bursts without exiting is
+// emitted at its next block, and the rest of it becomes a new process
+// arriving at the next wakeup. Memory is therefore bounded by the live
+// tasks, whatever the length of the trace.
+class TraceImporter {
+public:
+    explicit TraceImporter(const TraceConfig& config = TraceConfig());
+
+    // Feed one line of the trace; false when it holds no scheduler event
+    bool addLine(const std::string& line);
+
+    // End of trace: emit every task still alive, in pid order. A task
+    // still blocked loses its final I/O burst.
+    void finish();
+
+    // Append the processes emitted since the last drain to `out`; returns how many
+    size_t drainProcesses(std::vector<Process>& out);
+
+    const TraceStats& stats() const { return counts; }
+
+private:
+    enum TaskState { TASK_RUNNABLE, TASK_RUNNING, TASK_BLOCKED };
+
+    struct TraceTask {
+        Process process;
+        TaskState state = TASK_RUNNABLE;
+        long long since = 0;        // Trace time the current state began, in ns
+        long long ran = 0;          // CPU time of the burst in progress, in ns
+        int pendingCpu = -1;        // Bursts not yet stored in `process`
+        int pendingIo = -1;
+        bool split = false;         // Emitted while blocked; the next wakeup starts a new process
+    };
+
+    TraceTask& task(int pid, long long arrival, TaskState state);
+    void wake(int pid, long long now);
+    void switchOut(int pid, const std::string& state, long long now);
+    void switchIn(int pid, long long now);
+    void addBurst(TraceTask& t, long long nanoseconds);
+    void emit(TraceTask& t);
+    int units(long long nanoseconds) const;
+    int arrivalTime(long long now) const;
+
+    TraceConfig config;
+    std::unordered_map<int, TraceTask> tasks;
+    std::vector<Process> ready;
+    long long start = -1;           // First timestamp of the trace, in ns
+    long long last = 0;
+    TraceStats counts;
+};
+
+// Import a whole trace file
+std::vector<Process> readTraceFile(const std::string& filePath, const TraceConfig& config = TraceConfig());
+
+#endif // TRACE_H
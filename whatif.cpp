@@ -0,0 +1,92 @@
+#include "whatif.h"
+
+#include <algorithm>
+#include <stdexcept>
+using namespace std;
+
+
+static vector<SimTime> periodSet(const vector<ProcessSpec>& processes) {
+    vector<SimTime> periods;
+    for (const ProcessSpec& p : processes) {
+        if (p.period > 0) {
+            periods.push_back(p.period);
+        }
+    }
+    sort(periods.begin(), periods.end());
+    periods.erase(unique(periods.begin(), periods.end()), periods.end());
+    return periods;
+}
+
+static bool sameGroups(const GroupTree& a, const GroupTree& b) {
+    return a.grouped() == b.grouped() && a.path == b.path && a.weight == b.weight;
+}
+
+WhatIfSession::WhatIfSession(Span<ProcessSpec> processes, const PolicyConfig& config, bool recordSchedule,
+                             SimTime checkpointInterval)
+    : workload(processes.begin(), processes.end()), config(config), recordSchedule(recordSchedule) {
+    if (checkpointInterval <= 0) {
+        // Work spread over the CPUs, or the last arrival if that is later
+        SimTime lastArrival = 0, totalWork = 0;
+        for (const ProcessSpec& p : workload) {
+            lastArrival = max(lastArrival, p.arrival);
+            totalWork += totalCpuTime(p);
+        }
+        SimTime horizon = max(lastArrival, totalWork / max(1, config.cpus.cpus));
+        checkpointInterval = max<SimTime>(1, horizon / 64);
+    }
+    this->config.cpus.checkpointInterval = checkpointInterval;
+
+    validateRun(workload, config);
+    MultiCpuConfig engine = this->config.cpus;
+    engine.recordSchedule = recordSchedule;
+    baseline = multiCpuScheduling(workload, config.policy, config.quantum, engine, &saved);
+}
+
+void WhatIfSession::simulate(const vector<WorkloadChange>& changes, MetricsSink& sink) {
+    vector<ProcessSpec> changed = workload;
+    SimTime earliest = NEVER;
+    for (const WorkloadChange& change : changes) {
+        if (change.process < changed.size()) {
+            earliest = min(earliest, changed[change.process].arrival);
+            changed[change.process] = change.spec;
+        } else if (change.process == changed.size()) {
+            changed.push_back(change.spec);
+        } else {
+            throw invalid_argument("what-if change names a process past the end of the workload");
+        }
+        earliest = min(earliest, change.spec.arrival);
+    }
+    validateRun(changed, config);
+
+    // Rate-monotonic levels rank the periods of the whole workload, so a
+    // change to the set of periods reorders processes already queued
+    if (config.policy == POLICY_RM && periodSet(changed) != periodSet(workload)) {
+        earliest = 0;
+    }
+    // Group queues are numbered by the tree, so its shape must not change either
+    if (config.policy == POLICY_CFS && !sameGroups(buildGroupTree(changed), buildGroupTree(workload))) {
+        earliest = 0;
+    }
+
+    // Tasks are numbered thread by thread, so no process may change its thread count
+    for (size_t i = 0; i < workload.size(); i++) {
+        if (changed[i].threads != workload[i].threads) {
+            earliest = 0;
+        }
+    }
+
+    MultiCpuConfig engine = config.cpus;
+    engine.recordSchedule = recordSchedule;
+    // Checkpoints are sorted by time; take the last one not after the change
+    auto after = upper_bound(saved.begin(), saved.end(), earliest,
+                             [](SimTime t, const EngineCheckpoint& checkpoint) { return t < checkpoint.time; });
+    if (after == saved.begin()) {
+        resumedFrom = 0;
+        reportRun(changed, runEngine(changed, config, recordSchedule), sink, config.cpus.devices);
+        return;
+    }
+    const EngineCheckpoint& checkpoint = *(after - 1);
+    resumedFrom = checkpoint.time;
+    reportRun(changed, resumeMultiCpuScheduling(changed, config.policy, config.quantum, engine, checkpoint, baseline),
+              sink, config.cpus.devices);
+}
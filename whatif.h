@@ -0,0 +1,46 @@
+#ifndef WHATIF_H
+#define WHATIF_H
+
+#include <vector>
+#include "engine.h"
+#include "simulator.h"
+#include "workload.h"
+
+// Replaces process `process` of the baseline, or appends a process when it
+// equals the workload size. The bursts are borrowed like any ProcessSpec.
+struct WorkloadChange {
+    size_t process;
+    ProcessSpec spec;
+};
+
+// Baseline run that keeps periodic checkpoints, for answering what-if
+// questions without re-simulating the unchanged prefix
+class WhatIfSession {
+public:
+    // Runs the baseline at once. An interval of 0 picks one that gives
+    // roughly 64 checkpoints over the expected makespan.
+    WhatIfSession(Span<ProcessSpec> baseline, const PolicyConfig& config, bool recordSchedule,
+                  SimTime checkpointInterval = 0);
+
+    const MultiCpuResult& baselineResult() const { return baseline; }
+    size_t checkpoints() const { return saved.size(); }
+
+    // Simulate the baseline with `changes` applied and report it to the sink.
+    // Resumes from the last checkpoint before the earliest changed arrival,
+    // old or new; the result equals a full run. Throws std::invalid_argument
+    // for a change that is neither a replacement nor the next append.
+    void simulate(const std::vector<WorkloadChange>& changes, MetricsSink& sink);
+
+    // Time the last what-if run resumed from (0 for a full run)
+    SimTime lastResumeTime() const { return resumedFrom; }
+
+private:
+    std::vector<ProcessSpec> workload;
+    PolicyConfig config;
+    bool recordSchedule;
+    MultiCpuResult baseline;
+    std::vector<EngineCheckpoint> saved;
+    SimTime resumedFrom = 0;
+};
+
+#endif // WHATIF_H
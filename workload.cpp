@@ -0,0 +1,314 @@
+#include "workload.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+using namespace std;
+
+
+bool BurstCursor::next(const ProcessSpec& process, int& value) {
+    if (process.runs.empty()) {
+        size_t index = offset / 2;
+        const Span<int>& bursts = offset % 2 == 0 ? process.cpuBursts : process.ioBursts;
+        if (index >= bursts.size()) {
+            return false;
+        }
+        value = bursts[index];
+        offset++;
+        return true;
+    }
+    for (; run < (int)process.runs.size(); run++, offset = 0) {
+        const BurstRun& r = process.runs[run];
+        if (offset < (long long)r.length * r.repeat) {
+            value = process.tokens[r.start + offset % r.length];
+            offset++;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Call visit(burst, times) for every CPU burst value with how often it occurs.
+// Even token positions are CPU bursts. A run of odd length flips parity on
+// every repetition, so each of its tokens is a CPU burst half the time.
+template <typename Visit>
+static void forEachCpuBurst(const ProcessSpec& process, Visit visit) {
+    for (int burst : process.cpuBursts) {
+        visit(burst, 1);
+    }
+    long long position = 0;
+    for (const BurstRun& run : process.runs) {
+        for (int j = 0; j < run.length; j++) {
+            bool cpuFirst = (position + j) % 2 == 0;
+            long long times;
+            if (run.length % 2 == 0) {
+                times = cpuFirst ? run.repeat : 0;
+            } else {
+                times = cpuFirst ? (run.repeat + 1) / 2 : run.repeat / 2;
+            }
+            visit(process.tokens[run.start + j], times);
+        }
+        position += (long long)run.length * run.repeat;
+    }
+}
+
+ProcessSpec threadSpec(const ProcessSpec& process, int thread) {
+    ProcessSpec spec = process;
+    spec.threads = 1;
+    spec.threadRuns = Span<int>();
+    if (!process.threadRuns.empty()) {
+        int first = process.threadRuns[thread];
+        int last = thread + 1 < (int)process.threadRuns.size() ? process.threadRuns[thread + 1] : process.runs.size();
+        spec.runs = Span<BurstRun>(process.runs.data() + first, last - first);
+    }
+    return spec;
+}
+
+// Sum of visit(thread) over the threads of a process
+template <typename Visit>
+static long long sumThreads(const ProcessSpec& process, Visit visit) {
+    if (process.threadRuns.empty()) {
+        return process.threads * visit(process);
+    }
+    long long total = 0;
+    for (int k = 0; k < (int)process.threadRuns.size(); k++) {
+        total += visit(threadSpec(process, k));
+    }
+    return total;
+}
+
+static SimTime sequenceCpuTime(const ProcessSpec& process) {
+    SimTime total = 0;
+    forEachCpuBurst(process, [&](int burst, long long times) { total += times * burst; });
+    return total;
+}
+
+SimTime totalCpuTime(const ProcessSpec& process) {
+    return sumThreads(process, sequenceCpuTime);
+}
+
+long long cpuBurstCount(const ProcessSpec& process) {
+    return sumThreads(process, [](const ProcessSpec& thread) {
+        long long count = 0;
+        forEachCpuBurst(thread, [&](int, long long times) { count += times; });
+        return count;
+    });
+}
+
+SimTime longestThreadCpuTime(const ProcessSpec& process) {
+    if (process.threadRuns.empty()) {
+        return sequenceCpuTime(process);
+    }
+    SimTime longest = 0;
+    for (int k = 0; k < (int)process.threadRuns.size(); k++) {
+        longest = max(longest, sequenceCpuTime(threadSpec(process, k)));
+    }
+    return longest;
+}
+
+// Parse the bursts of a line with repeat groups or thread separators into
+// the run-length form. Bursts outside groups become runs that are repeated
+// once. Returns the text after the end marker.
+static const char* parseRepeatGroups(const char* text, Process& p) {
+    int plainStart = 0;
+    auto flushPlain = [&]() {
+        int length = p.tokens.size() - plainStart;
+        if (length > 0) {
+            p.runs.push_back({plainStart, length, 1});
+        }
+    };
+
+    int groupStart = -1;
+    while (true) {
+        while (isspace((unsigned char)*text)) {
+            text++;
+        }
+        if (*text == '(' && groupStart < 0) {
+            flushPlain();
+            groupStart = p.tokens.size();
+            text++;
+        } else if (*text == '|' && groupStart < 0) {
+            // The next thread's bursts start with a new run
+            flushPlain();
+            if (p.threadRuns.empty()) {
+                p.threadRuns.push_back(0);
+            }
+            p.threadRuns.push_back(p.runs.size());
+            plainStart = p.tokens.size();
+            text++;
+        } else if (*text == ')' && groupStart >= 0) {
+            text++;
+            while (isspace((unsigned char)*text)) {
+                text++;
+            }
+            long repeat = 1;
+            if (*text == 'x' || *text == 'X') {
+                char* end;
+                repeat = strtol(text + 1, &end, 10);
+                text = end;
+            }
+            p.runs.push_back({groupStart, (int)p.tokens.size() - groupStart, (int)max(0L, repeat)});
+            plainStart = p.tokens.size();
+            groupStart = -1;
+        } else {
+            char* end;
+            long value = strtol(text, &end, 10);
+            if (end == text || value == -1) {
+                text = end;
+                break;  // End marker or end of line
+            }
+            p.tokens.push_back(value);
+            text = end;
+        }
+    }
+    if (groupStart >= 0) {
+        // Unclosed group: count it once
+        plainStart = groupStart;
+    }
+    flushPlain();
+    return text;
+}
+
+// Optional "name=value" fields after the end marker
+static void parseAttributes(istream& in, Process& p) {
+    string field;
+    while (in >> field) {
+        size_t equals = field.find('=');
+        if (equals == string::npos) {
+            continue;
+        }
+        string name = field.substr(0, equals);
+        int value = atoi(field.c_str() + equals + 1);
+        if (name == "period") {
+            p.period = value;
+        } else if (name == "deadline") {
+            p.deadline = value;
+        } else if (name == "group") {
+            p.group = field.substr(equals + 1);
+        } else if (name == "weight") {
+            p.weight = value;
+        } else if (name == "device") {
+            p.device = value;
+        } else if (name == "threads") {
+            p.threads = value;
+        }
+    }
+}
+
+bool parseWorkloadLine(const string& line, Process& p) {
+    istringstream iss(line);
+    int value;
+
+    p.cpuBursts.clear();
+    p.ioBursts.clear();
+    p.tokens.clear();
+    p.runs.clear();
+    p.period = 0;
+    p.deadline = 0;
+    p.group.clear();
+    p.weight = 0;
+    p.device = -1;
+    p.threads = 1;
+    p.threadRuns.clear();
+    if (!(iss >> p.arrivalTime)) {
+        return false;  // Blank line
+    }
+    if (line.find_first_of("(|") != string::npos) {
+        istringstream rest(parseRepeatGroups(line.c_str() + iss.tellg(), p));
+        parseAttributes(rest, p);
+        if (!p.threadRuns.empty()) {
+            p.threads = p.threadRuns.size();
+        }
+        return true;
+    }
+
+    bool isCpuBurst = true;
+    while (iss >> value && value != -1) {
+        if (isCpuBurst) {
+            p.cpuBursts.push_back(value);
+        } else {
+            p.ioBursts.push_back(value);
+        }
+        isCpuBurst = !isCpuBurst;
+    }
+    parseAttributes(iss, p);
+    return true;
+}
+
+string formatWorkloadLine(const Process& p) {
+    ostringstream out;
+    out << p.arrivalTime;
+    if (p.runs.empty()) {
+        for (size_t i = 0; i < p.cpuBursts.size(); i++) {
+            out << ' ' << p.cpuBursts[i];
+            if (i < p.ioBursts.size()) {
+                out << ' ' << p.ioBursts[i];
+            }
+        }
+    }
+    size_t nextThread = 1;
+    for (size_t r = 0; r < p.runs.size(); r++) {
+        for (; nextThread < p.threadRuns.size() && p.threadRuns[nextThread] == (int)r; nextThread++) {
+            out << " |";
+        }
+        const BurstRun& run = p.runs[r];
+        bool grouped = run.repeat != 1;
+        out << (grouped ? " (" : " ");
+        for (int j = 0; j < run.length; j++) {
+            out << (j > 0 ? " " : "") << p.tokens[run.start + j];
+        }
+        if (grouped) {
+            out << ")x" << run.repeat;
+        }
+    }
+    for (; nextThread < p.threadRuns.size(); nextThread++) {
+        out << " |";
+    }
+    out << " -1";
+    if (p.period > 0) {
+        out << " period=" << p.period;
+    }
+    if (p.deadline > 0) {
+        out << " deadline=" << p.deadline;
+    }
+    if (!p.group.empty()) {
+        out << " group=" << p.group;
+    }
+    if (p.weight > 0) {
+        out << " weight=" << p.weight;
+    }
+    if (p.device >= 0) {
+        out << " device=" << p.device;
+    }
+    if (p.threadRuns.empty() && p.threads != 1) {
+        out << " threads=" << p.threads;
+    }
+    return out.str();
+}
+
+// Read workload file
+vector<Process> readWorkloadFile(const string& filePath) {
+    ifstream infile(filePath);
+    vector<Process> processes;
+    string line;
+    Process p;
+
+    while (getline(infile, line)) {
+        if (parseWorkloadLine(line, p)) {
+            processes.push_back(p);
+        }
+    }
+
+    return processes;
+}
+
+vector<ProcessSpec> processSpecs(const vector<Process>& processes) {
+    vector<ProcessSpec> specs;
+    specs.reserve(processes.size());
+    for (const Process& p : processes) {
+        specs.push_back(p.spec());
+    }
+    return specs;
+}
@@ -0,0 +1,126 @@
+#ifndef WORKLOAD_H
+#define WORKLOAD_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+typedef long long SimTime;
+
+// Read-only view over contiguous elements owned by someone else
+// (a stand-in for std::span<const T>, which needs C++20)
+template <typename T>
+class Span {
+public:
+    Span() = default;
+    Span(const T* data, size_t size) : ptr(data), count(size) {}
+    Span(const std::vector<T>& values) : ptr(values.data()), count(values.size()) {}
+
+    const T* data() const { return ptr; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T& operator[](size_t i) const { return ptr[i]; }
+    const T* begin() const { return ptr; }
+    const T* end() const { return ptr + count; }
+
+private:
+    const T* ptr = nullptr;
+    size_t count = 0;
+};
+
+// A stretch of a run-length encoded burst sequence:
+// tokens[start, start + length) repeated `repeat` times
+struct BurstRun {
+    int start;
+    int length;
+    int repeat;
+};
+
+// Description of one process as seen by the simulator. The burst arrays are
+// borrowed, never copied, and must outlive the simulation.
+struct ProcessSpec {
+    SimTime arrival = 0;
+    Span<int> cpuBursts;
+    Span<int> ioBursts;         // ioBursts[i] follows cpuBursts[i]
+    // Run-length form, used instead of the two arrays when `runs` is set.
+    // The runs expand, one after another, to CPU and I/O bursts alternately,
+    // starting with a CPU burst.
+    Span<int> tokens;
+    Span<BurstRun> runs;
+    // Real-time parameters, 0 when absent. CPU burst j of a periodic process
+    // is a job released at arrival + j * period, or once the preceding I/O
+    // completes if that is later. Each job is due `deadline` after its
+    // release; the deadline defaults to the period.
+    SimTime period = 0;
+    SimTime deadline = 0;
+    // Group path such as "/tenant:200/web", null for the root, and the
+    // process's weight within its group (0 for the default)
+    const char* group = nullptr;
+    int weight = 0;
+    int device = -1;            // I/O device (see MultiCpuConfig::devices), -1 for unbounded I/O
+    // Threads, which all arrive with the process. With `threadRuns` empty
+    // every thread runs the whole burst sequence; otherwise thread k runs
+    // the run-length form from runs[threadRuns[k]] up to the next thread's.
+    int threads = 1;
+    Span<int> threadRuns;
+};
+
+// Position in the burst sequence of a process. The run-length form is walked
+// lazily, so repeated bursts are never expanded.
+struct BurstCursor {
+    int run = 0;
+    long long offset = 0;       // Token index, within the current run for the run-length form
+
+    // Read the next burst, CPU and I/O alternately; false at the end
+    bool next(const ProcessSpec& process, int& value);
+};
+
+// The burst sequence of one thread, as a single-threaded process
+ProcessSpec threadSpec(const ProcessSpec& process, int thread);
+
+// Summed over all threads
+SimTime totalCpuTime(const ProcessSpec& process);
+long long cpuBurstCount(const ProcessSpec& process);
+// CPU time of the thread that needs the most, the least time the process can take
+SimTime longestThreadCpuTime(const ProcessSpec& process);
+
+// A process parsed from a workload file; owns its bursts. Lines with
+// repeat groups fill the run-length form and leave the burst vectors empty.
+struct Process {
+    int arrivalTime;
+    std::vector<int> cpuBursts;
+    std::vector<int> ioBursts;
+    std::vector<int> tokens;
+    std::vector<BurstRun> runs;
+    int period = 0;
+    int deadline = 0;
+    std::string group;
+    int weight = 0;
+    int device = -1;
+    int threads = 1;
+    std::vector<int> threadRuns;
+
+    ProcessSpec spec() const {
+        return {arrivalTime, cpuBursts, ioBursts, tokens, runs, period, deadline,
+                group.empty() ? nullptr : group.c_str(), weight, device, threads, threadRuns};
+    }
+};
+
+// Parse one "<arrival> <cpu> <io> <cpu> ... -1" line; false for a blank line.
+// Bursts may be grouped and repeated, as in "0 (15 2)x10000 5 -1", and the
+// end marker may be followed by "period=P", "deadline=D", "group=PATH",
+// "weight=W", "device=N" and "threads=T" (T threads sharing the bursts).
+// Bursts separated by "|", as in "0 10 2 10 | 30 -1", give every thread its
+// own sequence.
+bool parseWorkloadLine(const std::string& line, Process& p);
+
+// The workload line of a process, the inverse of parseWorkloadLine
+std::string formatWorkloadLine(const Process& p);
+
+// Read workload file
+std::vector<Process> readWorkloadFile(const std::string& filePath);
+
+// Views over parsed processes, for handing them to the simulator
+std::vector<ProcessSpec> processSpecs(const std::vector<Process>& processes);
+
+#endif // WORKLOAD_H